@@ -40,6 +40,16 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
     #include "obdmacro.h"
 #undef OBD_DEFINE_MACRO
 
+// Lean profile for memory constrained CNs: the per-node arrays only cover
+// node IDs up to CONFIG_APP_LEAN_OD_MAX_NODE_ID, a single RPDO channel is
+// kept and the mapping tables are sized for the objects the CN links.
+// The matching XDDs are generated by tools/xdd-lean.py.
+#if defined(CONFIG_APP_LEAN_OD)
+#define OD_MAX_NODE_ID      CONFIG_APP_LEAN_OD_MAX_NODE_ID
+#else
+#define OD_MAX_NODE_ID      NMT_MAX_NODE_ID
+#endif
+
 OBD_BEGIN()
     /*************************************************************************
      * Communication Profile Area (0x1000 - 0x1FFF)
@@ -56,10 +66,20 @@ OBD_BEGIN()
             OBD_SUBINDEX_RAM_VAR(0x1001, 0x00, kObdTypeUInt8, kObdAccR, tObdUnsigned8, ERR_ErrorRegister_U8, 0x00)
         OBD_END_INDEX(0x1001)
 
-/*
-        // Object 1003h: ERR_History_ADOM
-        OBD_RAM_INDEX_RAM_VARARRAY_NOINIT(0x1003, 10, FALSE, tObdDomain, kObdAccR, tObdDomain, ERR_History_ADOM)
-*/
+        // Object 1003h: ERR_History_ADOM, linked and counted by src/errhist.c
+        OBD_BEGIN_INDEX_RAM(0x1003, 0x0B, FALSE)
+            OBD_SUBINDEX_RAM_VAR(0x1003, 0x00, kObdTypeUInt8, kObdAccR, tObdUnsigned8, NumberOfEntries, 0x00)
+            OBD_SUBINDEX_RAM_DOMAIN(0x1003, 0x01, kObdAccR, ErrorEntry_DOM)
+            OBD_SUBINDEX_RAM_DOMAIN(0x1003, 0x02, kObdAccR, ErrorEntry_DOM)
+            OBD_SUBINDEX_RAM_DOMAIN(0x1003, 0x03, kObdAccR, ErrorEntry_DOM)
+            OBD_SUBINDEX_RAM_DOMAIN(0x1003, 0x04, kObdAccR, ErrorEntry_DOM)
+            OBD_SUBINDEX_RAM_DOMAIN(0x1003, 0x05, kObdAccR, ErrorEntry_DOM)
+            OBD_SUBINDEX_RAM_DOMAIN(0x1003, 0x06, kObdAccR, ErrorEntry_DOM)
+            OBD_SUBINDEX_RAM_DOMAIN(0x1003, 0x07, kObdAccR, ErrorEntry_DOM)
+            OBD_SUBINDEX_RAM_DOMAIN(0x1003, 0x08, kObdAccR, ErrorEntry_DOM)
+            OBD_SUBINDEX_RAM_DOMAIN(0x1003, 0x09, kObdAccR, ErrorEntry_DOM)
+            OBD_SUBINDEX_RAM_DOMAIN(0x1003, 0x0A, kObdAccR, ErrorEntry_DOM)
+        OBD_END_INDEX(0x1003)
 
         // Object 1006h: NMT_CycleLen_U32 in [us]
         OBD_BEGIN_INDEX_RAM(0x1006, 0x01, FALSE)
@@ -82,8 +102,9 @@ OBD_BEGIN()
         OBD_END_INDEX(0x100A)
 
 #if defined(CONFIG_APP_STORE_RESTORE)
+        // 0x1010 and 0x1011 are only in the _configStoreRestore XDDs
         // Object 1010h: NMT_StoreParam_REC
-        OBD_BEGIN_INDEX_RAM(0x1010, 0x05, FALSE)
+        OBD_BEGIN_INDEX_RAM(0x1010, 0x05, TRUE)
             OBD_SUBINDEX_RAM_VAR(0x1010, 0x00, kObdTypeUInt8, kObdAccConst, tObdUnsigned8, NumberOfEntries, 0x04)
             OBD_SUBINDEX_RAM_VAR_NOINIT(0x1010, 0x01, kObdTypeUInt32, kObdAccRW, tObdUnsigned32, AllParam_U32)
             OBD_SUBINDEX_RAM_VAR_NOINIT(0x1010, 0x02, kObdTypeUInt32, kObdAccRW, tObdUnsigned32, CommunicationParam_U32)
@@ -92,7 +113,7 @@ OBD_BEGIN()
         OBD_END_INDEX(0x1010)
 
         // Object 1011h: NMT_RestoreDefParam_REC
-        OBD_BEGIN_INDEX_RAM(0x1011, 0x05, FALSE)
+        OBD_BEGIN_INDEX_RAM(0x1011, 0x05, TRUE)
             OBD_SUBINDEX_RAM_VAR(0x1011, 0x00, kObdTypeUInt8, kObdAccConst, tObdUnsigned8, NumberOfEntries, 0x04)
             OBD_SUBINDEX_RAM_VAR_NOINIT(0x1011, 0x01, kObdTypeUInt32, kObdAccRW, tObdUnsigned32, AllParam_U32)
             OBD_SUBINDEX_RAM_VAR_NOINIT(0x1011, 0x02, kObdTypeUInt32, kObdAccRW, tObdUnsigned32, CommunicationParam_U32)
@@ -133,9 +154,9 @@ OBD_BEGIN()
             OBD_SUBINDEX_RAM_VAR(0x1030, 0x09, kObdTypeBool, kObdAccRW, tObdBoolean, Valid_BOOL, 0x01)
         OBD_END_INDEX(0x1030)
 
-#if (defined(CONFIG_DLL_PRES_CHAINING_CN) && (NMT_MAX_NODE_ID > 0))
+#if (defined(CONFIG_DLL_PRES_CHAINING_CN) && (OD_MAX_NODE_ID > 0))
         // Object 1050h: NMT_RelativeLatencyDiff_AU32
-        OBD_RAM_INDEX_RAM_ARRAY(0x1050, NMT_MAX_NODE_ID, FALSE, kObdTypeUInt32, kObdAccR, tObdUnsigned32, NMT_RelativeLatencyDiff_AU32, 0)
+        OBD_RAM_INDEX_RAM_ARRAY(0x1050, OD_MAX_NODE_ID, FALSE, kObdTypeUInt32, kObdAccR, tObdUnsigned32, NMT_RelativeLatencyDiff_AU32, 0)
 #endif
 
         // Object 1300h: SDO_SequLayerTimeout_U32 in [ms]
@@ -150,6 +171,7 @@ OBD_BEGIN()
             OBD_SUBINDEX_RAM_VAR(0x1400, 0x02, kObdTypeUInt8, kObdAccSRW, tObdUnsigned8, MappingVersion_U8, 0x00)
         OBD_END_INDEX(0x1400)
 
+#if !defined(CONFIG_APP_LEAN_OD)
         // Object 1401h: PDO_RxCommParam_01h_REC
         OBD_BEGIN_INDEX_RAM(0x1401, 0x03, FALSE)
             OBD_SUBINDEX_RAM_VAR(0x1401, 0x00, kObdTypeUInt8, kObdAccConst, tObdUnsigned8, NumberOfEntries, 0x02)
@@ -163,14 +185,20 @@ OBD_BEGIN()
             OBD_SUBINDEX_RAM_VAR_RG(0x1402, 0x01, kObdTypeUInt8, kObdAccSGRW, tObdUnsigned8, NodeID_U8, 0, 0, 254)
             OBD_SUBINDEX_RAM_VAR(0x1402, 0x02, kObdTypeUInt8, kObdAccSRW, tObdUnsigned8, MappingVersion_U8, 0x00)
         OBD_END_INDEX(0x1402)
+#endif
 
         // Object 1600h: PDO_RxMappParam_00h_AU64
+#if !defined(CONFIG_APP_LEAN_OD)
         OBD_BEGIN_INDEX_RAM(0x1600, 0x1A, FALSE)
+#else
+        OBD_BEGIN_INDEX_RAM(0x1600, 0x05, FALSE)
+#endif
             OBD_SUBINDEX_RAM_VAR(0x1600, 0x00, kObdTypeUInt8, kObdAccSRW, tObdUnsigned8, NumberOfEntries, 0x00)
             OBD_SUBINDEX_RAM_VAR(0x1600, 0x01, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
             OBD_SUBINDEX_RAM_VAR(0x1600, 0x02, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
             OBD_SUBINDEX_RAM_VAR(0x1600, 0x03, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
             OBD_SUBINDEX_RAM_VAR(0x1600, 0x04, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
+#if !defined(CONFIG_APP_LEAN_OD)
             OBD_SUBINDEX_RAM_VAR(0x1600, 0x05, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
             OBD_SUBINDEX_RAM_VAR(0x1600, 0x06, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
             OBD_SUBINDEX_RAM_VAR(0x1600, 0x07, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
@@ -192,8 +220,10 @@ OBD_BEGIN()
             OBD_SUBINDEX_RAM_VAR(0x1600, 0x17, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
             OBD_SUBINDEX_RAM_VAR(0x1600, 0x18, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
             OBD_SUBINDEX_RAM_VAR(0x1600, 0x19, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
+#endif
         OBD_END_INDEX(0x1600)
 
+#if !defined(CONFIG_APP_LEAN_OD)
         // Object 1601h: PDO_RxMappParam_01h_AU64
         OBD_BEGIN_INDEX_RAM(0x1601, 0x1A, FALSE)
             OBD_SUBINDEX_RAM_VAR(0x1601, 0x00, kObdTypeUInt8, kObdAccSRW, tObdUnsigned8, NumberOfEntries, 0x00)
@@ -253,6 +283,7 @@ OBD_BEGIN()
             OBD_SUBINDEX_RAM_VAR(0x1602, 0x18, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
             OBD_SUBINDEX_RAM_VAR(0x1602, 0x19, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
         OBD_END_INDEX(0x1602)
+#endif
 
         // Object 1800h: PDO_TxCommParam_00h_REC
         OBD_BEGIN_INDEX_RAM(0x1800, 0x03, FALSE)
@@ -262,7 +293,11 @@ OBD_BEGIN()
         OBD_END_INDEX(0x1800)
 
         // Object 1A00h: PDO_TxMappParam_00h_AU64
+#if !defined(CONFIG_APP_LEAN_OD)
         OBD_BEGIN_INDEX_RAM(0x1A00, 0x1A, FALSE)
+#else
+        OBD_BEGIN_INDEX_RAM(0x1A00, 0x11, FALSE)
+#endif
             OBD_SUBINDEX_RAM_VAR(0x1A00, 0x00, kObdTypeUInt8, kObdAccSRW, tObdUnsigned8, NumberOfEntries, 0x00)
             OBD_SUBINDEX_RAM_VAR(0x1A00, 0x01, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
             OBD_SUBINDEX_RAM_VAR(0x1A00, 0x02, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
@@ -280,6 +315,7 @@ OBD_BEGIN()
             OBD_SUBINDEX_RAM_VAR(0x1A00, 0x0E, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
             OBD_SUBINDEX_RAM_VAR(0x1A00, 0x0F, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
             OBD_SUBINDEX_RAM_VAR(0x1A00, 0x10, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
+#if !defined(CONFIG_APP_LEAN_OD)
             OBD_SUBINDEX_RAM_VAR(0x1A00, 0x11, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
             OBD_SUBINDEX_RAM_VAR(0x1A00, 0x12, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
             OBD_SUBINDEX_RAM_VAR(0x1A00, 0x13, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
@@ -289,6 +325,7 @@ OBD_BEGIN()
             OBD_SUBINDEX_RAM_VAR(0x1A00, 0x17, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
             OBD_SUBINDEX_RAM_VAR(0x1A00, 0x18, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
             OBD_SUBINDEX_RAM_VAR(0x1A00, 0x19, kObdTypeUInt64, kObdAccSRW, tObdUnsigned64, ObjectMapping, 0x0000000000000000LL)
+#endif
         OBD_END_INDEX(0x1A00)
 
         // Object 1C0Bh: DLL_CNLossSoC_REC
@@ -340,9 +377,9 @@ OBD_BEGIN()
         OBD_END_INDEX(0x1E4A)
 #endif
 
-#if NMT_MAX_NODE_ID > 0
+#if OD_MAX_NODE_ID > 0
         // Object 1F81h: NMT_NodeAssignment_AU32
-        OBD_RAM_INDEX_RAM_ARRAY_ALT(0x1F81, NMT_MAX_NODE_ID, FALSE, kObdTypeUInt32, kObdAccSRW, tObdUnsigned32, NMT_NodeAssignment_AU32, 0)
+        OBD_RAM_INDEX_RAM_ARRAY_ALT(0x1F81, OD_MAX_NODE_ID, FALSE, kObdTypeUInt32, kObdAccSRW, tObdUnsigned32, NMT_NodeAssignment_AU32, 0)
 #endif
 
         // Object 1F82h: NMT_FeatureFlags_U32
@@ -360,9 +397,9 @@ OBD_BEGIN()
             OBD_SUBINDEX_RAM_VAR(0x1F8C, 0x00, kObdTypeUInt8, kObdAccR, tObdUnsigned8, NMT_CurrNMTState_U8, 0x1C)
         OBD_END_INDEX(0x1F8C)
 
-#if NMT_MAX_NODE_ID > 0
+#if OD_MAX_NODE_ID > 0
         // Object 1F8Dh: NMT_PResPayloadLimitList_AU16
-        OBD_RAM_INDEX_RAM_ARRAY_ALT(0x1F8D, NMT_MAX_NODE_ID, FALSE, kObdTypeUInt16, kObdAccSRW, tObdUnsigned16, NMT_PResPayloadLimitList_AU16, 36)
+        OBD_RAM_INDEX_RAM_ARRAY_ALT(0x1F8D, OD_MAX_NODE_ID, FALSE, kObdTypeUInt16, kObdAccSRW, tObdUnsigned16, NMT_PResPayloadLimitList_AU16, 36)
 #endif
 
         // Object 1F93h: NMT_EPLNodeID_REC
@@ -410,9 +447,9 @@ OBD_BEGIN()
         OBD_END_INDEX(0x1F9A)
 #endif
 
-#if NMT_MAX_NODE_ID > 0
+#if OD_MAX_NODE_ID > 0
         // Object 1F9Bh: NMT_MultiplCycleAssign_AU8
-        OBD_RAM_INDEX_RAM_ARRAY_ALT(0x1F9B, NMT_MAX_NODE_ID, FALSE, kObdTypeUInt8, kObdAccSRW, tObdUnsigned8, NMT_MultiplCycleAssign_AU8, 0)
+        OBD_RAM_INDEX_RAM_ARRAY_ALT(0x1F9B, OD_MAX_NODE_ID, FALSE, kObdTypeUInt8, kObdAccSRW, tObdUnsigned8, NMT_MultiplCycleAssign_AU8, 0)
 #endif
 
         // Object 1F9Eh: NMT_ResetCmd_U8
@@ -427,6 +464,23 @@ OBD_BEGIN()
      *************************************************************************/
     OBD_BEGIN_PART_MANUFACTURER()
 
+        // InputStatus_REC
+        OBD_BEGIN_INDEX_RAM(0x2000, 0x05, FALSE)
+            OBD_SUBINDEX_RAM_VAR(0x2000, 0x00, kObdTypeUInt8, kObdAccConst, tObdUnsigned8, NumberOfEntries, 0x04)
+            OBD_SUBINDEX_RAM_USERDEF(0x2000, 0x01, kObdTypeUInt16, kObdAccVPR, tObdUnsigned16, CycleSequence_U16, 0x0000)
+            OBD_SUBINDEX_RAM_USERDEF(0x2000, 0x02, kObdTypeUInt16, kObdAccVPR, tObdUnsigned16, InputEventAge_U16, 0x0000)
+            OBD_SUBINDEX_RAM_USERDEF(0x2000, 0x03, kObdTypeUInt16, kObdAccVPR, tObdUnsigned16, InputPollAge_U16, 0x0000)
+            OBD_SUBINDEX_RAM_USERDEF(0x2000, 0x04, kObdTypeUInt8, kObdAccVPR, tObdUnsigned8, InputStatus_U8, 0x00)
+        OBD_END_INDEX(0x2000)
+
+        // InputTimeStamp_REC: NetTime of the latest input changes, late by the
+        // smallest sync wakeup latency and off by the clock drift over up to 2 s
+        OBD_BEGIN_INDEX_RAM(0x2001, 0x03, FALSE)
+            OBD_SUBINDEX_RAM_VAR(0x2001, 0x00, kObdTypeUInt8, kObdAccConst, tObdUnsigned8, NumberOfEntries, 0x02)
+            OBD_SUBINDEX_RAM_USERDEF(0x2001, 0x01, kObdTypeUInt64, kObdAccVPR, tObdUnsigned64, AxisNetTime_U64, 0x0000000000000000LL)
+            OBD_SUBINDEX_RAM_USERDEF(0x2001, 0x02, kObdTypeUInt64, kObdAccVPR, tObdUnsigned64, ButtonNetTime_U64, 0x0000000000000000LL)
+        OBD_END_INDEX(0x2001)
+
     OBD_END_PART()
 
     /*************************************************************************
@@ -462,18 +516,32 @@ OBD_BEGIN()
         OBD_END_INDEX(0x6400)
 
         // AnalogueInput_00h_AI16
-        OBD_BEGIN_INDEX_RAM(0x6401, 0x03, FALSE)
-            OBD_SUBINDEX_RAM_VAR(0x6401, 0x00, kObdTypeUInt8, kObdAccConst, tObdUnsigned8, NumberOfEntries, 0x02)
+        // 0x01 - 0x02 stick axes, 0x03 - 0x06 virtual channels mixed from them
+        OBD_BEGIN_INDEX_RAM(0x6401, 0x07, FALSE)
+            OBD_SUBINDEX_RAM_VAR(0x6401, 0x00, kObdTypeUInt8, kObdAccConst, tObdUnsigned8, NumberOfEntries, 0x06)
             OBD_SUBINDEX_RAM_USERDEF(0x6401, 0x01, kObdTypeInt16, kObdAccVPR, tObdInteger16, AnalogueInput, 0x0000)
             OBD_SUBINDEX_RAM_USERDEF(0x6401, 0x02, kObdTypeInt16, kObdAccVPR, tObdInteger16, AnalogueInput, 0x0000)
+            OBD_SUBINDEX_RAM_USERDEF(0x6401, 0x03, kObdTypeInt16, kObdAccVPR, tObdInteger16, AnalogueInput, 0x0000)
+            OBD_SUBINDEX_RAM_USERDEF(0x6401, 0x04, kObdTypeInt16, kObdAccVPR, tObdInteger16, AnalogueInput, 0x0000)
+            OBD_SUBINDEX_RAM_USERDEF(0x6401, 0x05, kObdTypeInt16, kObdAccVPR, tObdInteger16, AnalogueInput, 0x0000)
+            OBD_SUBINDEX_RAM_USERDEF(0x6401, 0x06, kObdTypeInt16, kObdAccVPR, tObdInteger16, AnalogueInput, 0x0000)
         OBD_END_INDEX(0x6401)
 
         // AnalogueInput_00h_AI32
-        OBD_BEGIN_INDEX_RAM(0x6402, 0x02, FALSE)
-            OBD_SUBINDEX_RAM_VAR(0x6402, 0x00, kObdTypeUInt8, kObdAccConst, tObdUnsigned8, NumberOfEntries, 0x01)
+        OBD_BEGIN_INDEX_RAM(0x6402, 0x03, FALSE)
+            OBD_SUBINDEX_RAM_VAR(0x6402, 0x00, kObdTypeUInt8, kObdAccConst, tObdUnsigned8, NumberOfEntries, 0x02)
             OBD_SUBINDEX_RAM_USERDEF(0x6402, 0x01, kObdTypeInt32, kObdAccVPR, tObdInteger32, AnalogueInput, 0x00000000)
+            OBD_SUBINDEX_RAM_USERDEF(0x6402, 0x02, kObdTypeInt32, kObdAccVPR, tObdInteger32, AnalogueInput, 0x00000000)
         OBD_END_INDEX(0x6402)
 
+        // AnalogueInput_00h_AIR32
+        OBD_BEGIN_INDEX_RAM(0x6403, 0x03, FALSE)
+            OBD_SUBINDEX_RAM_VAR(0x6403, 0x00, kObdTypeUInt8, kObdAccConst, tObdUnsigned8, NumberOfEntries, 0x02)
+            OBD_SUBINDEX_RAM_USERDEF(0x6403, 0x01, kObdTypeReal32, kObdAccVPR, tObdReal32, AnalogueInput, 0.0)
+            OBD_SUBINDEX_RAM_USERDEF(0x6403, 0x02, kObdTypeReal32, kObdAccVPR, tObdReal32, AnalogueInput, 0.0)
+        OBD_END_INDEX(0x6403)
+
+#if !defined(CONFIG_APP_LEAN_OD)
         // AnalogueOutput_00h_AI8
         OBD_BEGIN_INDEX_RAM(0x6410, 0x05, FALSE)
             OBD_SUBINDEX_RAM_VAR(0x6410, 0x00, kObdTypeUInt8, kObdAccConst, tObdUnsigned8, NumberOfEntries, 0x04)
@@ -495,6 +563,7 @@ OBD_BEGIN()
             OBD_SUBINDEX_RAM_VAR(0x6412, 0x00, kObdTypeUInt8, kObdAccConst, tObdUnsigned8, NumberOfEntries, 0x01)
             OBD_SUBINDEX_RAM_USERDEF(0x6412, 0x01, kObdTypeInt32, kObdAccVPRW, tObdInteger32, AnalogueOutput, 0x00000000)
         OBD_END_INDEX(0x6412)
+#endif
 
     OBD_END_PART()
 
@@ -1,56 +1,147 @@
 #include <fcntl.h>
-#include <linux/joystick.h>
 #include <signal.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 #include <oplk/oplk.h>
 #include <oplk/debugstr.h>
-#if defined(CONFIG_USE_SYNCTHREAD)
 #include <pthread.h>
-#endif
 #include <errno.h>
 #include "app.h"
+#include "axisplan.h"
+#include "capture.h"
+#include "ctlsock.h"
+#include "errhist.h"
+#include "input.h"
+#include "mix.h"
+#include "predict.h"
+#include "trace.h"
+#if defined(CONFIG_APP_IO_URING)
+#include "uring.h"
+#endif
 
-static int joystick_fd;
 static joystick_state_t *joystick_state;
+static pthread_t input_setup_thread;
+static int input_setup_running;
+static int input_uring;         /* inputs are read through io_uring */
+static volatile unsigned int inputs_attached;
+
+/* NMT state: process data is exchanged, inputs are read as they come.
+   Otherwise they are drained every APP_IDLE_DRAIN_MS.  The event thread
+   signals changes on active_fd to wake the input loop. */
+static volatile int pi_active;
+static int active_fd = -1;
+
+/* faults seen by the sync path, raised in the error history */
+static int sync_fault;          /* process image exchange failed */
+static int input_stale;         /* APP_STATUS_STALE */
+
+/* Freshness bookkeeping.  The sync path counts cycles, the input side
+   just remembers the cycle in which it last saw an event and in which it
+   last polled.  Plain stores on both sides, no locking needed. */
+static volatile UINT32 cycle_count;
+static volatile UINT32 last_event_cycle;
+static volatile UINT32 last_poll_cycle;
+static UINT64 last_poll_ns;     /* CLOCK_MONOTONIC of the last pass */
+
+/* The inputs are read into input_channels, see input.h.  Its time stamps
+   are converted to NetTime by the sync path. */
+static UINT64 input_read_ns;    /* when the current batch was read */
+
+/* Offset from the SoC RelativeTime to CLOCK_MONOTONIC, the smallest seen
+   in the current and the previous window of APP_SOC_WINDOW_NS.  Only used
+   by the sync path. */
+#define APP_SOC_WINDOW_NS  1000000000ULL
+static INT64  soc_offset_min, soc_offset_prev;
+static UINT64 soc_window_start; /* 0 before the first SoC */
+
+/* optional extrapolation of the axes to the transmission instant */
+static int       predict_enabled;
+static UINT64    predict_cycle_ns;       /* 0x1006 NMT_CycleLen_U32 */
+static UINT64    predict_offset_ns;      /* PRes offset */
+static UINT64    predict_option_ns;      /* PRes offset of the command line */
+static volatile UINT64 predict_lead_ns;  /* updated by the event thread */
+static predict_t predictor;
+
+/* conversion of the axes to the types they are linked with */
+static axis_plan_t axis_plan;
 
-#if defined(CONFIG_USE_SYNCTHREAD)
+/* virtual channels mixed from the axes */
+static mix_t axis_mix;
+
+/* The process image is only locked if processSync() runs concurrently
+   with the input handling, i.e. not in the main loop sync model. */
 static pthread_mutex_t joystick_state_mutex;
-#endif
+static int joystick_state_locking;
+
+static inline void lock_state(void) {
+  if (joystick_state_locking)
+    pthread_mutex_lock(&joystick_state_mutex);
+}
+
+static inline void unlock_state(void) {
+  if (joystick_state_locking)
+    pthread_mutex_unlock(&joystick_state_mutex);
+}
+
+static void         arm_inputs(void);
+
 
-static void         on_joy_event(struct js_event *e);
+static int link_input(UINT16 index, UINT8 subindex, size_t offset, size_t size) {
+  tOplkError ret;
+  UINT varEntries = 1;
 
+  if ((ret = oplk_linkProcessImageObject(index, subindex, offset, FALSE,
+					 size, &varEntries)) != kErrorOk) {
+    fprintf(stderr,
+	    "Linking process vars failed with \"%s\" (0x%04x)\n",
+	    debugstr_getRetValStr(ret),
+	    ret);
+    return -1;
+  }
+  capture_add_object(index, subindex, offset, size);
+  return 0;
+}
 
 #define LINK_INPUT_PROCESS_VARIABLE(x, index, subindex) {		\
-    tOplkError  ret;							  \
-    UINT varEntries = 1;						  \
-    if ((ret = oplk_linkProcessImageObject(index,			  \
-					   subindex, 			  \
-					   offsetof(joystick_state_t, x), \
-					   FALSE,			  \
-					   sizeof(joystick_state->x),	  \
-					   &varEntries)) != kErrorOk) {	  \
-      fprintf(stderr,							  \
-	      "Linking process vars failed with \"%s\" (0x%04x)\n",	  \
-	      debugstr_getRetValStr(ret),				  \
-	      ret);							  \
-      return;								  \
-    }									  \
-  }
-
-void app_init(void)
+    if (link_input(index, subindex, offsetof(joystick_state_t, x),	\
+		   sizeof(joystick_state->x)) < 0)			\
+      return;								\
+  }
+
+/* analogue input object of each axis type, channel n is subindex n + 1 */
+static const struct {
+  UINT16 index;
+  size_t offset;
+  size_t size;
+} axis_objects[AXIS_N_TYPES] = {
+  [AXIS_INT8]   = { 0x6400, offsetof(joystick_state_t, axis_8),  sizeof(INT8) },
+  [AXIS_INT16]  = { 0x6401, offsetof(joystick_state_t, axis_x),  sizeof(INT16) },
+  [AXIS_INT32]  = { 0x6402, offsetof(joystick_state_t, axis_32), sizeof(INT32) },
+  [AXIS_REAL32] = { 0x6403, offsetof(joystick_state_t, axis_f),  sizeof(float) },
+};
+
+/* axis_types gives the data type each axis is linked with, NULL links
+   all of them to 0x6401.  The virtual channels of mix follow the axes in
+   0x6401, mix may be NULL. */
+void app_init(int concurrent_sync, const axis_type_t *axis_types, const mix_t *mix)
 {
-#if defined(CONFIG_USE_SYNCTHREAD)
+    axis_type_t type;
+    size_t offset;
+    int i;
+
     /* initialize the app data mutex */
     if (pthread_mutex_init(&joystick_state_mutex, 0) < 0) {
       perror("pthread_mutex_init");
       exit(1);
     }
-#endif
+    joystick_state_locking = concurrent_sync;
     
     /* Allocate process image */
     if (oplk_allocProcessImage(sizeof(joystick_state_t), 0) != kErrorOk) {
@@ -64,83 +155,520 @@ void app_init(void)
      * 2 axis joystick device profile. */
     LINK_INPUT_PROCESS_VARIABLE(buttons_00, 0x6000, 0x01);
     LINK_INPUT_PROCESS_VARIABLE(buttons_01, 0x6000, 0x02);
-    LINK_INPUT_PROCESS_VARIABLE(axis_x,     0x6401, 0x01);
-    LINK_INPUT_PROCESS_VARIABLE(axis_y,     0x6401, 0x02);
+
+    axisplan_init(&axis_plan);
+    for (i = 0; i < APP_AXES; i++) {
+      type = axis_types ? axis_types[i] : AXIS_INT16;
+      offset = axis_objects[type].offset + i * axis_objects[type].size;
+      if (link_input(axis_objects[type].index, i + 1, offset, axis_objects[type].size) < 0)
+	return;
+      axisplan_add(&axis_plan, type, i, offset);
+    }
+
+    if (mix != NULL)
+      axis_mix = *mix;
+    else
+      mix_init(&axis_mix);
+    for (i = 0; i < (int)axis_mix.n; i++)
+      LINK_INPUT_PROCESS_VARIABLE(axis_mix[i], 0x6401, APP_AXES + 1 + i);
+
+    /* data freshness and quality status */
+    LINK_INPUT_PROCESS_VARIABLE(cycle_seq,  0x2000, 0x01);
+    LINK_INPUT_PROCESS_VARIABLE(event_age,  0x2000, 0x02);
+    LINK_INPUT_PROCESS_VARIABLE(poll_age,   0x2000, 0x03);
+    LINK_INPUT_PROCESS_VARIABLE(status,     0x2000, 0x04);
+
+    /* NetTime of the latest input changes */
+    LINK_INPUT_PROCESS_VARIABLE(axis_time,   0x2001, 0x01);
+    LINK_INPUT_PROCESS_VARIABLE(button_time, 0x2001, 0x02);
+
+    if (active_fd < 0)
+      active_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    /* post the first read from the thread that runs the input loop, reads
+       posted by the input setup thread would be cancelled when it exits */
+    arm_inputs();
+}
+
+/* Called by the event handler on every NMT state change.  The predictor
+   starts over when the process data exchange resumes, its state is as old
+   as the idle period. */
+void app_set_active(int active) {
+  UINT64 one = 1;
+
+  if (active == pi_active)
+    return;
+  if (active && predict_enabled)
+    predict_init(&predictor, PREDICT_ALPHA, PREDICT_BETA);
+  pi_active = active;
+  if ((active_fd >= 0) && (write(active_fd, &one, sizeof(one)) < 0))
+    perror("eventfd");
+}
+
+int app_is_active(void) {
+  return pi_active;
+}
+
+/* Readable when app_is_active() has changed, app_ack_active() resets it */
+int app_get_active_fd(void) {
+  return active_fd;
+}
+
+void app_ack_active(void) {
+  UINT64 count;
+
+  if (read(active_fd, &count, sizeof(count)) < 0)
+    count = 0;
 }
 
 void app_shutdown(void) {
-#if defined(CONFIG_USE_SYNCTHREAD)
+  joystick_state_locking = 0;
   pthread_mutex_destroy(&joystick_state_mutex);
-#endif
   oplk_freeProcessImage();
-  close(joystick_fd);
+#if defined(CONFIG_APP_IO_URING)
+  uring_exit();
+#endif
+  input_remove_all();
+  if (active_fd >= 0)
+    close(active_fd);
+  active_fd = -1;
 }
 
-unsigned int processSync(void) {
+static inline UINT64 monotonic_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (UINT64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Estimate the CLOCK_MONOTONIC time at which the SoC arrived.  The SoC
+   carries the RelativeTime of the MN in microseconds, its difference to
+   the sync wakeup is the offset between the clocks plus the wakeup
+   latency.  The smallest difference seen lately is taken for the offset;
+   it is forgotten after one to two windows, so the estimate follows the
+   drift between the clocks and a restart of the MN.  The remaining error
+   is the smallest wakeup latency seen, which makes the arrival late, and
+   the drift of the clocks within two windows, at most 20 us at 10 ppm.
+   Without RelativeTime the wakeup is taken for the arrival. */
+static UINT64 soc_arrival_ns(const tOplkApiSocTimeInfo *soc, UINT64 sync_ns) {
+  UINT64 rel_ns = soc->relTime * 1000;
+  INT64 offset = (INT64)(sync_ns - rel_ns);
+
+  if (!soc->fValidRelTime)
+    return sync_ns;
+  if ((soc_window_start == 0) || (sync_ns - soc_window_start >= 2 * APP_SOC_WINDOW_NS))
+    soc_offset_min = offset;    /* first SoC, or after a pause */
+  if ((soc_window_start == 0) || (sync_ns - soc_window_start >= APP_SOC_WINDOW_NS)) {
+    soc_offset_prev = soc_offset_min;
+    soc_offset_min = offset;
+    soc_window_start = sync_ns;
+  } else if (offset < soc_offset_min) {
+    soc_offset_min = offset;
+  }
+  return rel_ns + ((soc_offset_min < soc_offset_prev) ? soc_offset_min : soc_offset_prev);
+}
+
+/* Convert a CLOCK_MONOTONIC time stamp to NetTime (seconds in the upper,
+   nanoseconds in the lower 32 bits), given the NetTime of the SoC and the
+   monotonic time at which it arrived.  A change between the arrival and
+   the sync wakeup is stamped after the SoC. */
+static inline UINT64 to_net_time(const tNetTime *soc, UINT64 soc_ns, UINT64 t_ns) {
+  INT64 net_ns = (INT64)soc->sec * 1000000000LL + soc->nsec;
+
+  if ((t_ns == 0) || (net_ns == 0))
+    return 0;
+  net_ns += (INT64)(t_ns - soc_ns);
+  if (net_ns <= 0)
+    return 0;
+  return ((UINT64)(net_ns / 1000000000LL) << 32) | (UINT64)(net_ns % 1000000000LL);
+}
+
+static inline UINT16 cycle_age(UINT32 now, UINT32 then) {
+  UINT32 age = now - then;
+
+  return (age > 0xFFFF) ? 0xFFFF : (UINT16)age;
+}
+
+/* Estimate the axes at the instant they are sent: the next SoC plus the
+   PRes offset. */
+static void predict_axes(UINT64 sync_ns, INT16 *out) {
+  INT16 z[PREDICT_AXES];
+  UINT64 t[PREDICT_AXES];
+  int i;
+
+  for (i = 0; i < PREDICT_AXES; i++) {
+    z[i] = (i < INPUT_ANALOGUE) ? input_channels.analogue[i] : 0;
+    t[i] = (i < INPUT_ANALOGUE) ? input_channels.analogue_ns[i] : 0;
+  }
+  predict_run(&predictor, z, t, sync_ns, sync_ns + predict_lead_ns, out);
+}
+
+/* Enable the axis predictor.  The axes are extrapolated from the sync to
+   the transmission of the PRes: one cycle plus the PRes offset.  The cycle
+   is the one the MN configured, see app_set_cycle_len(). */
+void app_set_prediction(UINT32 pres_offset_us) {
+  predict_init(&predictor, PREDICT_ALPHA, PREDICT_BETA);
+  predict_option_ns = (UINT64)pres_offset_us * 1000;
+  predict_offset_ns = predict_option_ns;
+  predict_lead_ns = predict_cycle_ns + predict_offset_ns;
+  predict_enabled = 1;
+}
+
+/* Set the cycle length, read from 0x1006 once the MN configured it */
+void app_set_cycle_len(UINT32 cycle_us) {
+  predict_cycle_ns = (UINT64)cycle_us * 1000;
+  predict_lead_ns = predict_cycle_ns + predict_offset_ns;
+}
+
+/* Replace the PRes offset of the predictor by the one the MN configured,
+   e.g. PResTimeFirst of a PRes chained CN, 0 restores the one given to
+   app_set_prediction().  No-op without prediction. */
+void app_set_pres_offset(UINT32 pres_offset_ns) {
+  if (!predict_enabled)
+    return;
+  predict_offset_ns = (pres_offset_ns != 0) ? pres_offset_ns : predict_option_ns;
+  predict_lead_ns = predict_cycle_ns + predict_offset_ns;
+}
+
+tOplkError processSync(void) {
   tOplkError  ret = kErrorOk;
+  UINT32      now;
+  UINT8       status = 0;
+  UINT64      sync_ns, soc_ns, poll_ns;
+  tOplkApiSocTimeInfo soc;
+  INT16       axes[PREDICT_AXES];
+  int         i;
   
   if (oplk_waitSyncEvent(100000) != kErrorOk)
     return ret;
+  sync_ns = monotonic_ns();
+  TRACE_PROBE0(sync_wakeup);
 
-#if defined(CONFIG_USE_SYNCTHREAD)
-  pthread_mutex_lock(&joystick_state_mutex);
-#endif
+  now = ++cycle_count;
+  if (oplk_getSocTime(&soc) != kErrorOk)
+    memset(&soc, 0, sizeof(soc));
+  soc_ns = soc_arrival_ns(&soc, sync_ns);
+  errhist_sync_clock(&soc.netTime, soc_ns);
+
+  lock_state();
+  joystick_state->buttons_00 = input_channels.digital[0];
+  joystick_state->buttons_01 = input_channels.digital[1];
+  joystick_state->cycle_seq = (UINT16)now;
+  joystick_state->event_age = cycle_age(now, last_event_cycle);
+  joystick_state->poll_age = cycle_age(now, last_poll_cycle);
+  if ((inputs_attached > 0) && (inputs_attached == input_count()))
+    status |= APP_STATUS_ATTACHED;
+  poll_ns = __atomic_load_n(&last_poll_ns, __ATOMIC_RELAXED);
+  if ((poll_ns != 0) && (sync_ns > poll_ns + APP_STALE_MS * 1000000ULL))
+    status |= APP_STATUS_STALE;
+  if (!(status & APP_STATUS_STALE) != !input_stale) {
+    input_stale = status & APP_STATUS_STALE;
+    if (input_stale)
+      errhist_raise(ERRHIST_INPUT_STALE, ERRHIST_REG_GENERIC, NULL, 0);
+    else
+      errhist_clear(ERRHIST_INPUT_STALE, ERRHIST_REG_GENERIC);
+  }
+  joystick_state->status = status;
+  joystick_state->axis_time = to_net_time(&soc.netTime, soc_ns, input_channels.analogue_last_ns);
+  joystick_state->button_time = to_net_time(&soc.netTime, soc_ns, input_channels.digital_ns);
+  if (predict_enabled) {
+    predict_axes(sync_ns, axes);
+  } else {
+    for (i = 0; i < PREDICT_AXES; i++)
+      axes[i] = (i < INPUT_ANALOGUE) ? input_channels.analogue[i] : 0;
+  }
+  axisplan_run(&axis_plan, axes, joystick_state);
+  if (axis_mix.n > 0)
+    mix_run(&axis_mix, axes, joystick_state->axis_mix);
+  TRACE_PROBE4(pi_publish,
+	       joystick_state->buttons_00, joystick_state->buttons_01,
+	       axes[0], axes[1]);
+  ctlsock_sync(joystick_state, now, sync_ns);
+  capture_record(joystick_state, now, sync_ns, &soc.netTime);
+  TRACE_PROBE0(exchange_start);
   ret = oplk_exchangeProcessImageIn();
-#if defined(CONFIG_USE_SYNCTHREAD)
-  pthread_mutex_unlock(&joystick_state_mutex);
-#endif
+  TRACE_PROBE1(exchange_end, ret);
+  unlock_state();
+
+  if ((ret != kErrorOk) != sync_fault) {
+    sync_fault = (ret != kErrorOk);
+    if (sync_fault)
+      errhist_raise(ERRHIST_SYNC, ERRHIST_REG_GENERIC | ERRHIST_REG_COMM, &ret, sizeof(ret));
+    else
+      errhist_clear(ERRHIST_SYNC, ERRHIST_REG_GENERIC | ERRHIST_REG_COMM);
+  }
   
   return ret;
 }
 
-void app_setup_inputs(char *joystick_device_name) {
-  int flags;
-  
-  if ((joystick_fd = open(joystick_device_name, O_RDONLY)) < 0) {
-    perror(joystick_device_name);
-    exit(1);
-  }
-  flags = fcntl(joystick_fd, F_GETFL, 0);
-  fcntl(joystick_fd, F_SETFL, flags | O_NONBLOCK);
+
+/* io_uring would fail reads of a non-blocking fd with EAGAIN instead of
+   waiting for the device */
+static inline int read_by_uring(const input_source_t *src) {
+  return input_uring && (src->ops->read_size > 0);
 }
 
-int app_get_input_fd(void) {
-  return joystick_fd;
+/* Record a fault of an input source in the error history, the first one
+   only until the source is attached again.  The additional information is
+   the errno and the index of the source, the status in 0x2000 only tells
+   about all sources together. */
+static void input_error(input_source_t *src, UINT16 code) {
+  UINT8 info[sizeof(int) + 1];
+  int err = errno;
+
+  if (src->fault != 0)
+    return;
+  src->fault = code;
+  memcpy(info, &err, sizeof(err));
+  info[sizeof(err)] = src - input_get(0);
+  errhist_raise(code, ERRHIST_REG_GENERIC | ERRHIST_REG_PROFILE, info, sizeof(info));
+}
+
+/* The fault of a source is over, the error is cleared once no other
+   source has it */
+static void input_recovered(input_source_t *src) {
+  UINT16 code = src->fault;
+  unsigned int i;
+
+  if (code == 0)
+    return;
+  src->fault = 0;
+  for (i = 0; i < input_count(); i++)
+    if (input_get(i)->fault == code)
+      return;
+  errhist_clear(code, ERRHIST_REG_GENERIC | ERRHIST_REG_PROFILE);
 }
 
-static void on_joy_event(struct js_event *e) {
-#if defined(CONFIG_USE_SYNCTHREAD)
-  pthread_mutex_lock(&joystick_state_mutex);
+/* An input source is gone, e.g. unplugged or its USB hub was reset.  Keep
+   the node running and publish safe values for its inputs (buttons
+   released, axes centered) until app_attach_inputs() gets it back. */
+static void detach_input(input_source_t *src) {
+  input_error(src, ERRHIST_INPUT_LOST);
+  input_close(src);
+  inputs_attached--;
+
+  lock_state();
+  input_clear(src);
+  unlock_state();
+  fprintf(stderr, "%s detached, inputs set to safe values\n", src->arg);
+}
+
+/* Register an input source, see input_add().  Before app_setup_inputs(). */
+int app_add_input(const char *spec) {
+  return (input_add(spec) != NULL) ? 0 : -1;
+}
+
+/* Register an input device of the type its node name suggests */
+int app_add_input_device(const char *path) {
+  return (input_add_device(path) != NULL) ? 0 : -1;
+}
+
+void app_setup_inputs(void) {
+  input_source_t *src;
+  unsigned int i;
+
+#if defined(CONFIG_APP_IO_URING)
+  input_uring = (uring_init() == 0);
 #endif
-  if (e->type & JS_EVENT_BUTTON) {
-    if (0 <= e->number && e->number <= 7)
-      joystick_state->buttons_00 &= e->value?1<<e->number:0;
-    else if (8 <= e->number && e->number <= 15)
-      joystick_state->buttons_01 &= e->value?1<<e->number:0;
-  }
-  if (e->type & JS_EVENT_AXIS) {
-    if (e->number == 0)
-      joystick_state->axis_x = e->value;
-    else if (e->number == 1)
-      joystick_state->axis_y = e->value;
-  }
-#if defined(CONFIG_USE_SYNCTHREAD)
-  pthread_mutex_unlock(&joystick_state_mutex);
+  for (i = 0; i < input_count(); i++) {
+    src = input_get(i);
+    if (input_open(src, !read_by_uring(src)) < 0) {
+      input_error(src, ERRHIST_INPUT_OPEN);
+      perror(src->arg);
+      fprintf(stderr, "Waiting for %s to appear\n", src->arg);
+    } else {
+      inputs_attached++;
+    }
+  }
+}
+
+/* Try to reopen the detached input sources, after the hotplug monitor has
+   seen a device node appear or periodically.  Returns 0 if all sources are
+   attached. */
+int app_attach_inputs(void) {
+  input_source_t *src;
+  unsigned int i;
+  int ret = 0;
+
+  for (i = 0; i < input_count(); i++) {
+    src = input_get(i);
+    if (src->fd >= 0)
+      continue;
+    if (input_open(src, !read_by_uring(src)) < 0) {
+      ret = -1;
+      continue;
+    }
+    inputs_attached++;
+    input_recovered(src);
+    fprintf(stderr, "%s attached: %s (%u buttons, %u axes)\n",
+	    src->arg, src->name, src->n_digital, src->n_analogue);
+  }
+  arm_inputs();
+  return ret;
+}
+
+static void *input_setup_thread_main(void *arg) {
+  UNUSED_PARAMETER(arg);
+  app_setup_inputs();
+  return NULL;
+}
+
+/* Open and probe the input sources in the background, so that it overlaps
+   with the initialization of the POWERLINK stack. */
+void app_start_input_setup(void) {
+  if (pthread_create(&input_setup_thread, NULL, input_setup_thread_main, NULL) != 0) {
+    app_setup_inputs();
+    return;
+  }
+  input_setup_running = 1;
+}
+
+void app_wait_input_setup(void) {
+  const input_source_t *src;
+  unsigned int i;
+
+  if (input_setup_running) {
+    pthread_join(input_setup_thread, NULL);
+    input_setup_running = 0;
+  }
+  for (i = 0; i < input_count(); i++) {
+    src = input_get(i);
+    if (src->fd < 0)
+      continue;
+    printf("Input %s: %s (%u buttons, %u axes%s)\n", src->arg, src->name,
+	   src->n_digital, src->n_analogue,
+	   (src->caps & INPUT_CAP_TIMESTAMP) ? ", time stamped" : "");
+  }
+}
+
+/* Add the fds to wait on for input: the ring for the sources read through
+   io_uring, the fds of the others.  Returns the new highest fd. */
+int app_fill_input_fds(fd_set *fds, int max_fd) {
+  const input_source_t *src;
+  unsigned int i;
+  int ring = 0;
+
+  for (i = 0; i < input_count(); i++) {
+    src = input_get(i);
+    if (src->fd < 0)
+      continue;
+    if (read_by_uring(src)) {
+      ring = 1;
+      continue;
+    }
+    FD_SET(src->fd, fds);
+    max_fd = (max_fd > src->fd) ? max_fd : src->fd;
+  }
+#if defined(CONFIG_APP_IO_URING)
+  if (ring) {
+    FD_SET(uring_get_fd(), fds);
+    max_fd = (max_fd > uring_get_fd()) ? max_fd : uring_get_fd();
+  }
+#else
+  UNUSED_PARAMETER(ring);
 #endif
+  return max_fd;
+}
+
+/* Called on every pass of the input loop, whether or not the device had
+   anything to read, so that the MN can tell a stick held still from an
+   input loop that stopped running. */
+void app_input_heartbeat(void) {
+  last_poll_cycle = cycle_count;
+  __atomic_store_n(&last_poll_ns, monotonic_ns(), __ATOMIC_RELAXED);
 }
 
+/* The process image, with the axes as read at 16 bit whatever they are
+   linked with */
 void app_get_inputs(joystick_state_t *state) {
   *state = *joystick_state;
+  state->axis_x = input_channels.analogue[0];
+  state->axis_y = input_channels.analogue[1];
+}
+
+#if defined(CONFIG_APP_IO_URING)
+/* The slot of a source in the io_uring buffer pool is its index */
+static void post_input_read(input_source_t *src, unsigned int slot) {
+  src->read_posted = (uring_post_read(slot, src->fd, src->ops->read_size) == 0);
 }
 
-void app_process_inputs(void) {
-  struct js_event joy_event;
+/* A read posted on the ring has finished: a joydev or evdev read returns
+   as many events as were queued, a hidraw read one report.  Repost the
+   read, it is submitted together with those of the other slots. */
+static void on_input_read(unsigned int slot, int res, UINT8 *buf) {
+  input_source_t *src = input_get(slot);
 
-  while (read(joystick_fd, &joy_event, sizeof(joy_event)) > 0) {
-    on_joy_event(&joy_event);
+  if ((src == NULL) || (src->fd < 0))
+    return;
+  src->read_posted = 0;
+  if (res <= 0) {
+    errno = res ? -res : ENODEV;
+    perror(src->arg);
+    detach_input(src);
+    return;
   }
-  if (errno != EAGAIN) {
-    perror("read()");
-    exit(1);
+
+  lock_state();
+  src->ops->decode(src, buf, res, input_read_ns);
+  unlock_state();
+  post_input_read(src, slot);
+}
+
+/* Harvest the completions in one batch and resubmit all reads with a
+   single system call.  Reads that complete while being submitted are
+   picked up by the next pass, without entering the kernel again. */
+static void process_uring_inputs(void) {
+  while (uring_harvest(on_input_read) > 0) {
+    if (uring_submit() < 0) {
+      perror("io_uring_enter()");
+      break;
+    }
+  }
+}
+#endif
+
+static void arm_inputs(void) {
+#if defined(CONFIG_APP_IO_URING)
+  input_source_t *src;
+  unsigned int i;
+  int posted = 0;
+
+  for (i = 0; i < input_count(); i++) {
+    src = input_get(i);
+    if ((src->fd >= 0) && read_by_uring(src) && !src->read_posted) {
+      post_input_read(src, i);
+      posted |= src->read_posted;
+    }
+  }
+  if (posted && (uring_submit() < 0))
+    perror("io_uring_enter()");
+#endif
+}
+
+/* Read the inputs that are ready in fds, or all of them if fds is NULL */
+void app_process_inputs(const fd_set *fds) {
+  UINT32 events = input_channels.events;
+  input_source_t *src;
+  unsigned int i;
+  int ret;
+
+  input_read_ns = monotonic_ns();
+#if defined(CONFIG_APP_IO_URING)
+  if (input_uring && ((fds == NULL) || FD_ISSET(uring_get_fd(), fds)))
+    process_uring_inputs();
+#endif
+  for (i = 0; i < input_count(); i++) {
+    src = input_get(i);
+    if ((src->fd < 0) || read_by_uring(src) || ((fds != NULL) && !FD_ISSET(src->fd, fds)))
+      continue;
+    lock_state();
+    ret = input_drain(src, input_read_ns);
+    unlock_state();
+    if (ret < 0) {
+      perror(src->arg);
+      detach_input(src);
+    }
   }
+  if (input_channels.events != events)
+    last_event_cycle = cycle_count;
 }
@@ -1,20 +1,66 @@
 #pragma once
 
+#include <sys/select.h>
 #include <oplk/oplk.h>
+#include "axisplan.h"
+#include "mix.h"
+
+#define APP_AXES  2
 
 /* structure for input process image.  Trying to make it look like a
    canopen CiA 401 compliant 2 axis joystick device profile. */
 typedef struct {
   UINT8  buttons_00; /* index: 0x6000; subindex: 0x01 */
   UINT8  buttons_01; /* index: 0x6000; subindex: 0x02 */
-  INT16  axis_x;     /* index: 0x6401; subindex: 0x02 */
-  INT16  axis_y;     /* index: 0x6401; subindex: 0x01 */
+  INT16  axis_x;     /* index: 0x6401; subindex: 0x01 */
+  INT16  axis_y;     /* index: 0x6401; subindex: 0x02 */
+  UINT16 cycle_seq;  /* index: 0x2000; subindex: 0x01 */
+  UINT16 event_age;  /* index: 0x2000; subindex: 0x02 */
+  UINT16 poll_age;   /* index: 0x2000; subindex: 0x03 */
+  UINT8  status;     /* index: 0x2000; subindex: 0x04 */
+  UINT64 axis_time;  /* index: 0x2001; subindex: 0x01 */
+  UINT64 button_time;/* index: 0x2001; subindex: 0x02 */
+  /* the axes linked with another resolution, see axisplan.h */
+  INT32  axis_32[APP_AXES]; /* index: 0x6402; subindex: 0x01.. */
+  float  axis_f[APP_AXES];  /* index: 0x6403; subindex: 0x01.. */
+  INT8   axis_8[APP_AXES];  /* index: 0x6400; subindex: 0x01.. */
+  INT16  axis_mix[MIX_CHANNELS]; /* index: 0x6401; subindex: 0x03.. */
 } joystick_state_t;
 
-void app_init(void);
+/* bits of joystick_state_t.status.  The status and the ages are of all
+   input sources together: a source that is open but silent does not show
+   next to a busy one.  A source that fails is named in 0x1003. */
+#define APP_STATUS_ATTACHED  0x01  /* all input sources are open */
+#define APP_STATUS_STALE     0x02  /* input loop did not run for APP_STALE_MS */
+
+/* The input loop wakes up at least every APP_POLL_MS while process data is
+   exchanged, the screen refresh.  It is stale once it missed several wake
+   ups: the threshold is a time, as the number of sync cycles in between
+   depends on the cycle time the MN configures.  The ages of 0x2000 count
+   sync cycles and saturate at 0xFFFF. */
+#define APP_POLL_MS          100
+#define APP_STALE_MS         (5 * APP_POLL_MS)
+
+/* Input drain interval while no process data is exchanged */
+#define APP_IDLE_DRAIN_MS    500
+
+void app_init(int concurrent_sync, const axis_type_t *axis_types, const mix_t *mix);
 void app_shutdown(void);
-unsigned int processSync(void);
-void app_setup_inputs(char *joystick_device_name);
-int  app_get_input_fd(void);
-void app_process_inputs(void);
+tOplkError processSync(void);
+int  app_add_input(const char *spec);
+int  app_add_input_device(const char *path);
+void app_setup_inputs(void);
+void app_start_input_setup(void);
+void app_wait_input_setup(void);
+int  app_attach_inputs(void);
+int  app_fill_input_fds(fd_set *fds, int max_fd);
+void app_process_inputs(const fd_set *fds);
+void app_input_heartbeat(void);
+void app_set_active(int active);
+int  app_is_active(void);
+int  app_get_active_fd(void);
+void app_ack_active(void);
+void app_set_prediction(UINT32 pres_offset_us);
+void app_set_cycle_len(UINT32 cycle_us);
+void app_set_pres_offset(UINT32 pres_offset_ns);
 void app_get_inputs(joystick_state_t *state);
@@ -0,0 +1,60 @@
+#include <string.h>
+#include "axisplan.h"
+
+static const char *const type_names[AXIS_N_TYPES] = { "8", "16", "32", "f" };
+
+/* Parse a comma separated list of channel types, e.g. "16,8".  Channels
+   not in the list keep their type.  Returns -1 on an unknown type. */
+int axisplan_parse(const char *s, axis_type_t *types, unsigned int n) {
+  unsigned int channel = 0, len;
+  int type;
+
+  while (*s != '\0') {
+    if (channel == n)
+      return -1;
+    len = strcspn(s, ",");
+    for (type = 0; type < AXIS_N_TYPES; type++)
+      if ((strlen(type_names[type]) == len) && (strncmp(s, type_names[type], len) == 0))
+	break;
+    if (type == AXIS_N_TYPES)
+      return -1;
+    types[channel++] = type;
+    s += len;
+    if (*s == ',')
+      s++;
+  }
+  return 0;
+}
+
+const char *axisplan_type_name(axis_type_t type) {
+  return (type < AXIS_N_TYPES) ? type_names[type] : "?";
+}
+
+void axisplan_init(axis_plan_t *plan) {
+  memset(plan, 0, sizeof(*plan));
+}
+
+/* Copy channel to offset in the process image, converted to type */
+int axisplan_add(axis_plan_t *plan, axis_type_t type, unsigned int channel,
+		 unsigned int offset) {
+  if ((type >= AXIS_N_TYPES) || (plan->n[type] == AXISPLAN_MAX_CHANNELS))
+    return -1;
+  plan->src[type][plan->n[type]] = channel;
+  plan->dst[type][plan->n[type]] = offset;
+  plan->n[type]++;
+  return 0;
+}
+
+void axisplan_run(const axis_plan_t *plan, const INT16 *in, void *image) {
+  UINT8 *pi = image;
+  unsigned int i;
+
+  for (i = 0; i < plan->n[AXIS_INT8]; i++)
+    *(INT8 *)(pi + plan->dst[AXIS_INT8][i]) = in[plan->src[AXIS_INT8][i]] >> 8;
+  for (i = 0; i < plan->n[AXIS_INT16]; i++)
+    *(INT16 *)(pi + plan->dst[AXIS_INT16][i]) = in[plan->src[AXIS_INT16][i]];
+  for (i = 0; i < plan->n[AXIS_INT32]; i++)
+    *(INT32 *)(pi + plan->dst[AXIS_INT32][i]) = (INT32)in[plan->src[AXIS_INT32][i]] * 65536;
+  for (i = 0; i < plan->n[AXIS_REAL32]; i++)
+    *(float *)(pi + plan->dst[AXIS_REAL32][i]) = in[plan->src[AXIS_REAL32][i]] * (1.0f / 32767.0f);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <oplk/oplk.h>
+
+/* Copy plan from the INT16 axis values to the analogue inputs of the
+   process image.  Every channel is linked with one data type:
+
+     AXIS_INT8    0x6400 AnalogueInput_00h_AI8,   upper 8 bits
+     AXIS_INT16   0x6401 AnalogueInput_00h_AI16,  as read
+     AXIS_INT32   0x6402 AnalogueInput_00h_AI32,  scaled to full range
+     AXIS_REAL32  0x6403 AnalogueInput_00h_AIR32, normalized to -1..1
+
+   The plan groups the channels by type when it is built, so that copying
+   runs one tight loop per type and never branches on a channel. */
+
+#define AXISPLAN_MAX_CHANNELS  8
+
+typedef enum {
+  AXIS_INT8,
+  AXIS_INT16,
+  AXIS_INT32,
+  AXIS_REAL32,
+  AXIS_N_TYPES
+} axis_type_t;
+
+typedef struct {
+  unsigned int n[AXIS_N_TYPES];
+  UINT8        src[AXIS_N_TYPES][AXISPLAN_MAX_CHANNELS];  /* channel */
+  UINT16       dst[AXIS_N_TYPES][AXISPLAN_MAX_CHANNELS];  /* byte offset */
+} axis_plan_t;
+
+int         axisplan_parse(const char *s, axis_type_t *types, unsigned int n);
+const char *axisplan_type_name(axis_type_t type);
+void        axisplan_init(axis_plan_t *plan);
+int         axisplan_add(axis_plan_t *plan, axis_type_t type, unsigned int channel,
+			 unsigned int offset);
+void        axisplan_run(const axis_plan_t *plan, const INT16 *in, void *image);
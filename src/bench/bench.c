@@ -0,0 +1,328 @@
+/* Microbenchmarks for the hot paths of the CN:
+
+   - event:  app_process_inputs() -> joydev source, fed from a pipe
+   - sync:   processSync() with the stack calls stubbed out
+   - hidraw: hidraw_decode() of raw reports from a typical gamepad
+   - predict: predict_run() on all axes of a moving stick
+   - mix:    mix_run() with all virtual channels in use
+   - screen: screen_draw_data() rendering into a dummy terminal
+
+   Results are written to stdout as JSON: ns/op, cycles/op (null if the
+   cycle counter is not available) and allocations/op. */
+
+#define _GNU_SOURCE
+#include <curses.h>
+#include <fcntl.h>
+#include <linux/joystick.h>
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "app.h"
+#include "hidraw.h"
+#include "mix.h"
+#include "predict.h"
+#include "screen.h"
+#include "bench.h"
+
+#define BENCH_MIN_NS      500000000ULL  /* measure each benchmark for 0.5 s */
+#define EVENT_BATCH       512
+#define SYNC_BATCH        1000
+#define HIDRAW_BATCH      1024
+#define HIDRAW_REPORT_LEN 8
+#define PREDICT_BATCH     1000
+#define PREDICT_PERIOD_NS 1000000ULL    /* 1 kHz sync */
+#define MIX_BATCH         1000
+#define SCREEN_BATCH      100
+
+unsigned long bench_alloc_count;
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) {
+  bench_alloc_count++;
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+  bench_alloc_count++;
+  return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  bench_alloc_count++;
+  return __libc_realloc(ptr, size);
+}
+
+static int event_pipe[2];
+static int cycles_fd = -1;
+
+static unsigned long long now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void cycles_open(void) {
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = PERF_COUNT_HW_CPU_CYCLES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  cycles_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  if (cycles_fd >= 0)
+    ioctl(cycles_fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+static unsigned long long cycles_read(void) {
+  unsigned long long cycles = 0;
+
+  if ((cycles_fd < 0) || (read(cycles_fd, &cycles, sizeof(cycles)) != sizeof(cycles)))
+    return 0;
+  return cycles;
+}
+
+/* event path */
+static void event_prepare(void) {
+  static struct js_event events[EVENT_BATCH];
+  static unsigned int seq;
+  int i;
+
+  for (i = 0; i < EVENT_BATCH; i++, seq++) {
+    events[i].time = seq;
+    if (i & 1) {
+      events[i].type = JS_EVENT_AXIS;
+      events[i].number = seq & 1;
+      events[i].value = (short)(seq * 37);
+    } else {
+      events[i].type = JS_EVENT_BUTTON;
+      events[i].number = seq & 15;
+      events[i].value = seq & 2;
+    }
+  }
+  if (write(event_pipe[1], events, sizeof(events)) != sizeof(events)) {
+    perror("write");
+    exit(1);
+  }
+}
+
+static unsigned int event_run(void) {
+  app_process_inputs(NULL);
+  return EVENT_BATCH;
+}
+
+/* sync path */
+static unsigned int sync_run(void) {
+  int i;
+
+  for (i = 0; i < SYNC_BATCH; i++)
+    processSync();
+  return SYNC_BATCH;
+}
+
+/* hidraw decoding: report ID 1, 16 buttons, 16 bit X/Y, hat switch */
+static const UINT8 gamepad_descriptor[] = {
+  0x05, 0x01,             /* Usage Page (Generic Desktop) */
+  0x09, 0x05,             /* Usage (Game Pad) */
+  0xA1, 0x01,             /* Collection (Application) */
+  0x85, 0x01,             /*   Report ID (1) */
+  0x05, 0x09,             /*   Usage Page (Button) */
+  0x19, 0x01,             /*   Usage Minimum (1) */
+  0x29, 0x10,             /*   Usage Maximum (16) */
+  0x15, 0x00,             /*   Logical Minimum (0) */
+  0x25, 0x01,             /*   Logical Maximum (1) */
+  0x75, 0x01,             /*   Report Size (1) */
+  0x95, 0x10,             /*   Report Count (16) */
+  0x81, 0x02,             /*   Input (Data, Var, Abs) */
+  0x05, 0x01,             /*   Usage Page (Generic Desktop) */
+  0x09, 0x30,             /*   Usage (X) */
+  0x09, 0x31,             /*   Usage (Y) */
+  0x16, 0x00, 0x80,       /*   Logical Minimum (-32768) */
+  0x26, 0xFF, 0x7F,       /*   Logical Maximum (32767) */
+  0x75, 0x10,             /*   Report Size (16) */
+  0x95, 0x02,             /*   Report Count (2) */
+  0x81, 0x02,             /*   Input (Data, Var, Abs) */
+  0x09, 0x39,             /*   Usage (Hat switch) */
+  0x15, 0x00,             /*   Logical Minimum (0) */
+  0x25, 0x07,             /*   Logical Maximum (7) */
+  0x75, 0x04,             /*   Report Size (4) */
+  0x95, 0x01,             /*   Report Count (1) */
+  0x81, 0x42,             /*   Input (Data, Var, Abs, Null) */
+  0x75, 0x04,             /*   Report Size (4) */
+  0x81, 0x03,             /*   Input (Const) */
+  0xC0                    /* End Collection */
+};
+
+static hidraw_plan_t gamepad_plan;
+static UINT8 hidraw_reports[HIDRAW_BATCH][HIDRAW_REPORT_LEN + HIDRAW_REPORT_PAD];
+
+static void hidraw_prepare(void) {
+  static unsigned int seq;
+  int i, j;
+
+  for (i = 0; i < HIDRAW_BATCH; i++, seq++) {
+    hidraw_reports[i][0] = 0x01;
+    for (j = 1; j < HIDRAW_REPORT_LEN; j++)
+      hidraw_reports[i][j] = (UINT8)(seq * 31 + j * 17);
+  }
+}
+
+static unsigned int hidraw_run(void) {
+  static UINT32 buttons;
+  static INT16 axes[HIDRAW_MAX_AXES];
+  int i;
+
+  for (i = 0; i < HIDRAW_BATCH; i++)
+    hidraw_decode(&gamepad_plan, hidraw_reports[i], HIDRAW_REPORT_LEN, &buttons, axes);
+  return HIDRAW_BATCH;
+}
+
+/* axis predictor: a stick sweeping back and forth, one update per cycle */
+static predict_t predictor;
+
+static unsigned int predict_run_batch(void) {
+  static UINT64 t = PREDICT_PERIOD_NS;
+  static INT16 z[PREDICT_AXES];
+  UINT64 t_meas[PREDICT_AXES];
+  INT16 out[PREDICT_AXES];
+  int i, j;
+
+  for (i = 0; i < PREDICT_BATCH; i++, t += PREDICT_PERIOD_NS) {
+    for (j = 0; j < PREDICT_AXES; j++) {
+      z[j] += 97 * (j + 1);
+      t_meas[j] = t - 300000;
+    }
+    predict_run(&predictor, z, t_meas, t, t + 2 * PREDICT_PERIOD_NS, out);
+  }
+  return PREDICT_BATCH;
+}
+
+/* virtual channels: differential steering, rotation by 30 degrees */
+static const char *const mix_channels[MIX_CHANNELS] = {
+  "0.5,0.5", "0.5,-0.5", "0.866,-0.5", "0.5,0.866,100"
+};
+static mix_t mix;
+
+static unsigned int mix_run_batch(void) {
+  static INT16 in[MIX_INPUTS];
+  static INT16 out[MIX_CHANNELS];
+  int i;
+
+  for (i = 0; i < MIX_BATCH; i++) {
+    in[0] += 97;
+    in[1] -= 31;
+    mix_run(&mix, in, out);
+  }
+  return MIX_BATCH;
+}
+
+/* screen path */
+static unsigned int screen_run(void) {
+  int i;
+
+  for (i = 0; i < SCREEN_BATCH; i++)
+    screen_draw_data();
+  return SCREEN_BATCH;
+}
+
+static void no_prepare(void) {
+}
+
+static const bench_t benchmarks[] = {
+  { "event",  event_prepare, event_run },
+  { "sync",   no_prepare,    sync_run },
+  { "hidraw", hidraw_prepare, hidraw_run },
+  { "predict", no_prepare,   predict_run_batch },
+  { "mix",    no_prepare,    mix_run_batch },
+  { "screen", no_prepare,    screen_run },
+};
+
+static void run_benchmark(const bench_t *bench, int last) {
+  unsigned long long ns = 0, cycles = 0, ops = 0, t0, c0;
+  unsigned long allocs = 0, a0;
+
+  /* warm up */
+  bench->prepare();
+  bench->run();
+
+  while (ns < BENCH_MIN_NS) {
+    bench->prepare();
+    a0 = bench_alloc_count;
+    c0 = cycles_read();
+    t0 = now_ns();
+    ops += bench->run();
+    ns += now_ns() - t0;
+    cycles += cycles_read() - c0;
+    allocs += bench_alloc_count - a0;
+  }
+
+  printf("    {\"name\": \"%s\", \"ops\": %llu, \"ns_per_op\": %.2f, ",
+	 bench->name, ops, (double)ns / ops);
+  if (cycles_fd >= 0)
+    printf("\"cycles_per_op\": %.2f, ", (double)cycles / ops);
+  else
+    printf("\"cycles_per_op\": null, ");
+  printf("\"allocs_per_op\": %.4f}%s\n", (double)allocs / ops, last ? "" : ",");
+}
+
+int main(void) {
+  char pipe_name[48];
+  SCREEN *screen;
+  FILE *null_out, *null_in;
+  unsigned int i;
+
+  /* joystick events come from a pipe opened as joydev source */
+  if (pipe(event_pipe) < 0) {
+    perror("pipe");
+    return 1;
+  }
+  snprintf(pipe_name, sizeof(pipe_name), "joydev:/proc/self/fd/%d", event_pipe[0]);
+  if (app_add_input(pipe_name) < 0)
+    return 1;
+  app_setup_inputs();
+
+  mix_init(&mix);
+  for (i = 0; i < MIX_CHANNELS; i++)
+    mix_add_channel(&mix, mix_channels[i]);
+
+  app_init(0, NULL, &mix);
+  predict_init(&predictor, PREDICT_ALPHA, PREDICT_BETA);
+
+  if ((hidraw_compile_plan(gamepad_descriptor, sizeof(gamepad_descriptor), &gamepad_plan) < 0) ||
+      (gamepad_plan.report_size != HIDRAW_REPORT_LEN)) {
+    fprintf(stderr, "hidraw_compile_plan() failed\n");
+    return 1;
+  }
+
+  /* dummy terminal for the screen benchmark */
+  null_out = fopen("/dev/null", "w");
+  null_in = fopen("/dev/null", "r");
+  if ((screen = newterm("vt100", null_out, null_in)) == NULL) {
+    fprintf(stderr, "newterm() failed\n");
+    return 1;
+  }
+  set_term(screen);
+  screen_draw_titles();
+
+  cycles_open();
+
+  printf("{\n  \"benchmarks\": [\n");
+  for (i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+    run_benchmark(&benchmarks[i], i == sizeof(benchmarks) / sizeof(benchmarks[0]) - 1);
+  printf("  ]\n}\n");
+
+  endwin();
+  delscreen(screen);
+  return 0;
+}
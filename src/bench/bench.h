@@ -0,0 +1,13 @@
+#pragma once
+
+/* Minimal benchmark harness.  Each benchmark is run in batches: prepare()
+   sets up the input of one batch outside of the measurement, run() executes
+   the batch and returns the number of operations it performed. */
+typedef struct {
+  const char   *name;
+  void        (*prepare)(void);
+  unsigned int (*run)(void);
+} bench_t;
+
+/* allocation counter maintained by the malloc wrappers in bench.c */
+extern unsigned long bench_alloc_count;
@@ -0,0 +1,90 @@
+/* Stand-ins for the openPOWERLINK API calls made on the benchmarked paths.
+   They return immediately, so the benchmarks measure the application code
+   without the stack. */
+#include <oplk/oplk.h>
+#include <oplk/debugstr.h>
+
+static UINT8 process_image_in[256];
+
+tOplkError oplk_allocProcessImage(UINT sizeProcessImageIn_p, UINT sizeProcessImageOut_p) {
+  UNUSED_PARAMETER(sizeProcessImageOut_p);
+  return (sizeProcessImageIn_p <= sizeof(process_image_in)) ? kErrorOk : kErrorNoResource;
+}
+
+tOplkError oplk_freeProcessImage(void) {
+  return kErrorOk;
+}
+
+void *oplk_getProcessImageIn(void) {
+  return process_image_in;
+}
+
+tOplkError oplk_linkProcessImageObject(UINT objIndex_p, UINT firstSubindex_p,
+				       UINT offsetPI_p, BOOL fOutputPI_p,
+				       tObdSize entrySize_p, UINT *pVarEntries_p) {
+  UNUSED_PARAMETER(objIndex_p);
+  UNUSED_PARAMETER(firstSubindex_p);
+  UNUSED_PARAMETER(offsetPI_p);
+  UNUSED_PARAMETER(fOutputPI_p);
+  UNUSED_PARAMETER(entrySize_p);
+  UNUSED_PARAMETER(pVarEntries_p);
+  return kErrorOk;
+}
+
+tOplkError oplk_linkObject(UINT objIndex_p, void *pVar_p, UINT *pVarEntries_p,
+			   tObdSize *pEntrySize_p, UINT firstSubindex_p) {
+  UNUSED_PARAMETER(objIndex_p);
+  UNUSED_PARAMETER(pVar_p);
+  UNUSED_PARAMETER(pVarEntries_p);
+  UNUSED_PARAMETER(pEntrySize_p);
+  UNUSED_PARAMETER(firstSubindex_p);
+  return kErrorOk;
+}
+
+tOplkError oplk_readLocalObject(UINT index_p, UINT subindex_p, void *pDstData_p,
+				size_t *pSize_p) {
+  UNUSED_PARAMETER(index_p);
+  UNUSED_PARAMETER(subindex_p);
+  UNUSED_PARAMETER(pDstData_p);
+  *pSize_p = 0;
+  return kErrorOk;
+}
+
+tOplkError oplk_writeLocalObject(UINT index_p, UINT subindex_p, const void *pSrcData_p,
+				 UINT size_p) {
+  UNUSED_PARAMETER(index_p);
+  UNUSED_PARAMETER(subindex_p);
+  UNUSED_PARAMETER(pSrcData_p);
+  UNUSED_PARAMETER(size_p);
+  return kErrorOk;
+}
+
+tOplkError oplk_postUserEvent(void *pUserArg_p) {
+  UNUSED_PARAMETER(pUserArg_p);
+  return kErrorOk;
+}
+
+tOplkError oplk_waitSyncEvent(ULONG timeout_p) {
+  UNUSED_PARAMETER(timeout_p);
+  return kErrorOk;
+}
+
+tOplkError oplk_exchangeProcessImageIn(void) {
+  return kErrorOk;
+}
+
+/* a SoC every millisecond, as far as the RelativeTime tells */
+tOplkError oplk_getSocTime(tOplkApiSocTimeInfo *pTimeInfo_p) {
+  static UINT64 relTime;
+
+  pTimeInfo_p->netTime.sec = 1;
+  pTimeInfo_p->netTime.nsec = 0;
+  pTimeInfo_p->relTime = (relTime += 1000);
+  pTimeInfo_p->fValidRelTime = TRUE;
+  return kErrorOk;
+}
+
+const char *debugstr_getRetValStr(tOplkError oplkError_p) {
+  UNUSED_PARAMETER(oplkError_p);
+  return "stub";
+}
@@ -0,0 +1,172 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include "capture.h"
+
+/* mapping of the process image, collected by capture_add_object() while
+   app_init() links it */
+static capture_object_t objects[CAPTURE_MAX_OBJECTS];
+static UINT32 n_objects;
+
+static int capture_fd = -1;
+static UINT8 *map;
+static size_t map_size;
+static capture_header_t *header;
+static UINT8 *ring;
+static UINT32 nmt_state;
+
+static pthread_t flush_thread;
+static pthread_mutex_t flush_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flush_cond;
+static int flush_stop;
+static int flush_running;
+
+void capture_add_object(UINT16 index, UINT8 subindex, size_t offset, size_t size) {
+  if (n_objects == CAPTURE_MAX_OBJECTS)
+    return;
+  objects[n_objects].index = index;
+  objects[n_objects].subindex = subindex;
+  objects[n_objects].size = size;
+  objects[n_objects].offset = offset;
+  n_objects++;
+}
+
+static void *flush_loop(void *arg) {
+  struct timespec ts;
+  int stop = 0;
+
+  (void)arg;
+  pthread_mutex_lock(&flush_mutex);
+  while (!stop) {
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += CAPTURE_FLUSH_MS / 1000;
+    ts.tv_nsec += (CAPTURE_FLUSH_MS % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000L;
+    }
+    while (!flush_stop &&
+	   (pthread_cond_timedwait(&flush_cond, &flush_mutex, &ts) != ETIMEDOUT))
+      ;
+    stop = flush_stop;
+    pthread_mutex_unlock(&flush_mutex);
+    if (msync(map, map_size, MS_SYNC) < 0)
+      perror("msync");
+    pthread_mutex_lock(&flush_mutex);
+  }
+  pthread_mutex_unlock(&flush_mutex);
+  return NULL;
+}
+
+/* Create the capture file with a ring of records for a process image of
+   pi_size bytes and start the flush thread. */
+int capture_open(const char *path, UINT32 records, size_t pi_size) {
+  pthread_condattr_t attr;
+  size_t record_size;
+  int err;
+
+  record_size = (sizeof(capture_record_t) + pi_size + 7) & ~(size_t)7;
+  map_size = CAPTURE_HEADER_SIZE + (size_t)records * record_size;
+
+  if ((capture_fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0) {
+    perror(path);
+    return -1;
+  }
+  /* allocate the blocks now, a full disk would raise SIGBUS in the sync
+     path otherwise */
+  if ((err = posix_fallocate(capture_fd, 0, map_size)) != 0) {
+    fprintf(stderr, "%s: %s\n", path, strerror(err));
+    capture_close();
+    return -1;
+  }
+  map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	     capture_fd, 0);
+  if (map == MAP_FAILED) {
+    perror("mmap");
+    map = NULL;
+    capture_close();
+    return -1;
+  }
+
+  header = (capture_header_t *)map;
+  memcpy(header->magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+  header->version = CAPTURE_VERSION;
+  header->header_size = CAPTURE_HEADER_SIZE;
+  header->record_size = record_size;
+  header->records = records;
+  header->written = 0;
+  header->pi_size = pi_size;
+  header->n_objects = n_objects;
+  header->closed = 0;
+  memcpy(header->objects, objects, n_objects * sizeof(objects[0]));
+  ring = map + CAPTURE_HEADER_SIZE;
+
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&flush_cond, &attr);
+  pthread_condattr_destroy(&attr);
+  flush_stop = 0;
+  if ((err = pthread_create(&flush_thread, NULL, flush_loop, NULL)) != 0) {
+    fprintf(stderr, "pthread_create: %s\n", strerror(err));
+    pthread_cond_destroy(&flush_cond);
+    capture_close();
+    return -1;
+  }
+  flush_running = 1;
+  return 0;
+}
+
+/* Stop the flush thread and write the capture back.  The sync processing
+   must be stopped. */
+void capture_close(void) {
+  if (flush_running) {
+    pthread_mutex_lock(&flush_mutex);
+    flush_stop = 1;
+    pthread_cond_signal(&flush_cond);
+    pthread_mutex_unlock(&flush_mutex);
+    pthread_join(flush_thread, NULL);
+    pthread_cond_destroy(&flush_cond);
+    flush_running = 0;
+  }
+  if (map != NULL) {
+    header->closed = 1;
+    msync(map, map_size, MS_SYNC);
+    munmap(map, map_size);
+  }
+  if (capture_fd >= 0)
+    close(capture_fd);
+  capture_fd = -1;
+  map = NULL;
+  header = NULL;
+  ring = NULL;
+}
+
+/* Called by the event handler on every NMT state change */
+void capture_set_nmt_state(tNmtState state) {
+  __atomic_store_n(&nmt_state, state, __ATOMIC_RELAXED);
+}
+
+/* Called by processSync() with the process image about to be exchanged */
+void capture_record(const void *pi, UINT32 cycle, UINT64 sync_ns, const tNetTime *soc) {
+  capture_record_t *r;
+  UINT64 n;
+
+  if (ring == NULL)
+    return;
+  n = header->written;
+  r = (capture_record_t *)(ring + (n % header->records) * header->record_size);
+  r->time_ns = sync_ns;
+  r->net_sec = soc->sec;
+  r->net_nsec = soc->nsec;
+  r->cycle = cycle;
+  r->nmt_state = __atomic_load_n(&nmt_state, __ATOMIC_RELAXED);
+  r->pi_size = header->pi_size;
+  memcpy(r->pi, pi, header->pi_size);
+  /* a reader of the live file sees the record complete once it is counted */
+  __atomic_store_n(&header->written, n + 1, __ATOMIC_RELEASE);
+}
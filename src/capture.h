@@ -0,0 +1,60 @@
+#pragma once
+
+#include <oplk/oplk.h>
+
+/* Per-cycle capture of the process image.  processSync() records the bytes
+   it hands to oplk_exchangeProcessImageIn() together with the cycle
+   counter, the monotonic and the NetTime of the sync and the NMT state.
+
+   The capture file is allocated and mapped when it is opened, so the sync
+   path only copies into memory: a header page followed by a ring of
+   fixed-size records, the oldest overwritten first.  A background thread
+   writes the mapping back to the file every CAPTURE_FLUSH_MS.  The header
+   also lists the objects linked into the process image, the decoder
+   (src/tools/capdecode.c) looks their data types up in the OD.
+
+   All fields are in host byte order. */
+
+#define CAPTURE_MAGIC        "PLKJCAP"
+#define CAPTURE_VERSION      1
+#define CAPTURE_HEADER_SIZE  4096
+#define CAPTURE_MAX_OBJECTS  64
+#define CAPTURE_RECORDS      65536   /* default ring size */
+#define CAPTURE_FLUSH_MS     1000
+
+typedef struct {
+  UINT16 index;
+  UINT8  subindex;
+  UINT8  size;
+  UINT16 offset;                 /* in the process image */
+  UINT16 reserved;
+} capture_object_t;
+
+typedef struct {
+  char   magic[8];
+  UINT32 version;
+  UINT32 header_size;
+  UINT32 record_size;
+  UINT32 records;                /* slots of the ring */
+  UINT64 written;                /* records written, record n is in slot n % records */
+  UINT32 pi_size;
+  UINT32 n_objects;
+  UINT32 closed;                 /* no record is being written */
+  capture_object_t objects[CAPTURE_MAX_OBJECTS];
+} capture_header_t;
+
+typedef struct {
+  UINT64 time_ns;                /* CLOCK_MONOTONIC of the sync */
+  UINT32 net_sec;                /* NetTime of the SoC */
+  UINT32 net_nsec;
+  UINT32 cycle;                  /* sync cycles processed */
+  UINT16 nmt_state;              /* tNmtState */
+  UINT16 pi_size;
+  UINT8  pi[];
+} capture_record_t;
+
+void capture_add_object(UINT16 index, UINT8 subindex, size_t offset, size_t size);
+int  capture_open(const char *path, UINT32 records, size_t pi_size);
+void capture_close(void);
+void capture_set_nmt_state(tNmtState state);
+void capture_record(const void *pi, UINT32 cycle, UINT64 sync_ns, const tNetTime *soc);
@@ -0,0 +1,337 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "ctlsock.h"
+
+typedef struct {
+  int    fd;
+  UINT8  streams;               /* CTL_SUB_* */
+  UINT16 decimation;
+  UINT8  seq;                   /* of the stream messages */
+  UINT32 dropped;
+} ctl_client_t;
+
+typedef struct {
+  UINT32 cycle;
+  UINT64 time_ns;
+  joystick_state_t pi;
+} ctl_snapshot_t;
+
+static int listen_fd = -1;
+static int wake_fd = -1;
+static char socket_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static ctl_client_t clients[CTLSOCK_MAX_CLIENTS];
+
+/* Snapshots of the process image, single producer (sync path) and single
+   consumer (main loop), taken every sync_decimation cycles: the greatest
+   common divisor of the decimations of the clients, 0 if there are none. */
+static ctl_snapshot_t ring[CTLSOCK_RING];
+static UINT32 ring_head, ring_tail;
+static UINT32 sync_decimation;
+static UINT32 sync_cycle;
+static UINT32 overruns;
+
+int ctlsock_init(const char *path) {
+  struct sockaddr_un addr;
+  int i;
+
+  for (i = 0; i < CTLSOCK_MAX_CLIENTS; i++)
+    clients[i].fd = -1;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "%s: socket path too long\n", path);
+    return -1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  if ((wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+    perror("eventfd");
+    return -1;
+  }
+  if ((listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
+    perror("socket");
+    ctlsock_shutdown();
+    return -1;
+  }
+  /* a socket left behind by a previous run */
+  unlink(path);
+  if ((bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) ||
+      (listen(listen_fd, CTLSOCK_MAX_CLIENTS) < 0)) {
+    perror(path);
+    ctlsock_shutdown();
+    return -1;
+  }
+  strcpy(socket_path, path);
+  return 0;
+}
+
+static void close_client(ctl_client_t *c) {
+  close(c->fd);
+  memset(c, 0, sizeof(*c));
+  c->fd = -1;
+}
+
+void ctlsock_shutdown(void) {
+  int i;
+
+  for (i = 0; i < CTLSOCK_MAX_CLIENTS; i++)
+    if (clients[i].fd >= 0)
+      close_client(&clients[i]);
+  if (listen_fd >= 0)
+    close(listen_fd);
+  if (wake_fd >= 0)
+    close(wake_fd);
+  if (socket_path[0] != '\0')
+    unlink(socket_path);
+  listen_fd = wake_fd = -1;
+  socket_path[0] = '\0';
+}
+
+int ctlsock_fill_fds(fd_set *fds, int max_fd) {
+  int i;
+
+  if (listen_fd < 0)
+    return max_fd;
+  FD_SET(listen_fd, fds);
+  FD_SET(wake_fd, fds);
+  max_fd = (max_fd > listen_fd) ? max_fd : listen_fd;
+  max_fd = (max_fd > wake_fd) ? max_fd : wake_fd;
+  for (i = 0; i < CTLSOCK_MAX_CLIENTS; i++) {
+    if (clients[i].fd >= 0) {
+      FD_SET(clients[i].fd, fds);
+      max_fd = (max_fd > clients[i].fd) ? max_fd : clients[i].fd;
+    }
+  }
+  return max_fd;
+}
+
+/* Called by processSync() with the process image about to be exchanged */
+void ctlsock_sync(const joystick_state_t *pi, UINT32 cycle, UINT64 sync_ns) {
+  UINT32 decimation = __atomic_load_n(&sync_decimation, __ATOMIC_RELAXED);
+  UINT64 one = 1;
+  ctl_snapshot_t *s;
+
+  __atomic_store_n(&sync_cycle, cycle, __ATOMIC_RELAXED);
+  if ((decimation == 0) || (cycle % decimation != 0))
+    return;
+  if (ring_head - __atomic_load_n(&ring_tail, __ATOMIC_ACQUIRE) == CTLSOCK_RING) {
+    __atomic_fetch_add(&overruns, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  s = &ring[ring_head & (CTLSOCK_RING - 1)];
+  s->cycle = cycle;
+  s->time_ns = sync_ns;
+  s->pi = *pi;
+  __atomic_store_n(&ring_head, ring_head + 1, __ATOMIC_RELEASE);
+  if (write(wake_fd, &one, sizeof(one)) < 0)
+    return;
+}
+
+/* Send without blocking, a full socket drops the message */
+static void send_client(ctl_client_t *c, const void *msg, size_t len) {
+  if (send(c->fd, msg, len, MSG_DONTWAIT | MSG_NOSIGNAL) >= 0)
+    return;
+  if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == ENOBUFS))
+    c->dropped++;
+  else
+    close_client(c);
+}
+
+static void fill_stats(ctl_stats_t *stats, const ctl_client_t *c, UINT32 cycle,
+		       const joystick_state_t *pi) {
+  stats->cycle = cycle;
+  stats->active = app_is_active();
+  stats->status = pi->status;
+  stats->event_age = pi->event_age;
+  stats->poll_age = pi->poll_age;
+  stats->overruns = __atomic_load_n(&overruns, __ATOMIC_RELAXED);
+  stats->dropped = c->dropped;
+}
+
+static UINT32 gcd(UINT32 a, UINT32 b) {
+  UINT32 t;
+
+  while (b != 0) {
+    t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+static void update_decimation(void) {
+  UINT32 decimation = 0;
+  int i;
+
+  for (i = 0; i < CTLSOCK_MAX_CLIENTS; i++)
+    if ((clients[i].fd >= 0) && (clients[i].streams != 0))
+      decimation = gcd(decimation, clients[i].decimation);
+  __atomic_store_n(&sync_decimation, decimation, __ATOMIC_RELAXED);
+}
+
+static void send_streams(const ctl_snapshot_t *s) {
+  ctl_pi_t msg;
+  ctl_stats_t stats;
+  ctl_client_t *c;
+  int i;
+
+  msg.hdr.type = CTL_STREAM_PI;
+  msg.cycle = s->cycle;
+  msg.time_ns = s->time_ns;
+  msg.pi = s->pi;
+  stats.hdr.type = CTL_STREAM_STATS;
+  for (i = 0; i < CTLSOCK_MAX_CLIENTS; i++) {
+    c = &clients[i];
+    if ((c->fd < 0) || (c->streams == 0) || (s->cycle % c->decimation != 0))
+      continue;
+    if (c->streams & CTL_SUB_PI) {
+      msg.hdr.seq = c->seq++;
+      send_client(c, &msg, sizeof(msg));
+    }
+    if ((c->fd >= 0) && (c->streams & CTL_SUB_STATS)) {
+      stats.hdr.seq = c->seq++;
+      fill_stats(&stats, c, s->cycle, &s->pi);
+      send_client(c, &stats, sizeof(stats));
+    }
+  }
+}
+
+static void drain_snapshots(void) {
+  UINT64 count;
+  UINT32 head;
+
+  if (read(wake_fd, &count, sizeof(count)) < 0)
+    return;
+  head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+  while (ring_tail != head) {
+    send_streams(&ring[ring_tail & (CTLSOCK_RING - 1)]);
+    __atomic_store_n(&ring_tail, ring_tail + 1, __ATOMIC_RELEASE);
+  }
+}
+
+static void accept_client(void) {
+  int fd, i;
+
+  while ((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+    for (i = 0; i < CTLSOCK_MAX_CLIENTS; i++)
+      if (clients[i].fd < 0)
+	break;
+    if (i == CTLSOCK_MAX_CLIENTS) {
+      close(fd);
+      continue;
+    }
+    clients[i].fd = fd;
+  }
+}
+
+/* Handle one request, returns CTLSOCK_REQ_* for the main loop */
+static int handle_request(ctl_client_t *c, const UINT8 *buf, size_t len) {
+  const ctl_header_t *hdr = (const ctl_header_t *)buf;
+  const ctl_object_t *obj = (const ctl_object_t *)buf;
+  const ctl_subscribe_t *sub = (const ctl_subscribe_t *)buf;
+  ctl_result_t res;
+  ctl_stats_t stats;
+  joystick_state_t pi;
+  size_t res_len = offsetof(ctl_result_t, data);
+  size_t size;
+  int req = 0;
+
+  res.hdr.type = hdr->type | CTL_REPLY;
+  res.hdr.seq = hdr->seq;
+  res.result = CTL_RESULT_INVALID;
+
+  switch (hdr->type) {
+  case CTL_RESET:
+    res.result = kErrorOk;
+    req = CTLSOCK_REQ_RESET;
+    break;
+
+  case CTL_STATS:
+    app_get_inputs(&pi);
+    stats.hdr = res.hdr;
+    fill_stats(&stats, c, __atomic_load_n(&sync_cycle, __ATOMIC_RELAXED), &pi);
+    send_client(c, &stats, sizeof(stats));
+    return 0;
+
+  case CTL_READ:
+    if (len != offsetof(ctl_object_t, data))
+      break;
+    size = sizeof(res.data);
+    res.result = oplk_readLocalObject(obj->index, obj->subindex, res.data, &size);
+    if (res.result == kErrorOk)
+      res_len += size;
+    break;
+
+  case CTL_WRITE:
+    if (len <= offsetof(ctl_object_t, data))
+      break;
+    res.result = oplk_writeLocalObject(obj->index, obj->subindex, obj->data,
+				       len - offsetof(ctl_object_t, data));
+    break;
+
+  case CTL_SUBSCRIBE:
+    if ((len != sizeof(*sub)) || ((sub->streams & ~(CTL_SUB_PI | CTL_SUB_STATS)) != 0))
+      break;
+    c->decimation = sub->decimation;
+    c->streams = (sub->decimation != 0) ? sub->streams : 0;
+    update_decimation();
+    res.result = kErrorOk;
+    break;
+
+  default:
+    break;
+  }
+  send_client(c, &res, res_len);
+  return req;
+}
+
+/* Serve up to CTLSOCK_MAX_REQUESTS messages of a client, the rest waits
+   for the next select() so that a busy client cannot hold up the loop */
+static int process_client(ctl_client_t *c) {
+  UINT8 buf[CTL_MAX_MSG];
+  ssize_t len = -1;
+  int req = 0, n = 0;
+
+  while ((c->fd >= 0) && (n++ < CTLSOCK_MAX_REQUESTS) &&
+	 ((len = recv(c->fd, buf, sizeof(buf), MSG_DONTWAIT)) != 0)) {
+    if (len < 0) {
+      if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+	close_client(c);
+      break;
+    }
+    if ((size_t)len >= sizeof(ctl_header_t))
+      req |= handle_request(c, buf, len);
+  }
+  if ((c->fd >= 0) && (len == 0))
+    close_client(c);
+  return req;
+}
+
+/* Serve the sockets that select() found ready.  Returns CTLSOCK_REQ_*
+   flags of the requests the main loop has to carry out. */
+int ctlsock_process(fd_set *fds) {
+  int i, req = 0, streams;
+
+  if (listen_fd < 0)
+    return 0;
+  if (FD_ISSET(wake_fd, fds))
+    drain_snapshots();
+  for (i = 0; i < CTLSOCK_MAX_CLIENTS; i++) {
+    if ((clients[i].fd >= 0) && FD_ISSET(clients[i].fd, fds)) {
+      streams = clients[i].streams;
+      req |= process_client(&clients[i]);
+      if (streams && (clients[i].fd < 0))
+	update_decimation();
+    }
+  }
+  if (FD_ISSET(listen_fd, fds))
+    accept_client();
+  return req;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <sys/select.h>
+#include <oplk/oplk.h>
+#include "app.h"
+
+/* Local control socket, a SOCK_SEQPACKET Unix domain socket served by the
+   main loop.  Every datagram is one message starting with the message type
+   and a sequence number the client chooses and the reply repeats.  All
+   fields are little endian and packed.
+
+   Requests and their replies (type | CTL_REPLY):
+
+     CTL_RESET      -                         result
+     CTL_STATS      -                         ctl_stats_t
+     CTL_READ       index, subindex           result, data
+     CTL_WRITE      index, subindex, data     result
+     CTL_SUBSCRIBE  streams, decimation       result
+
+   result is a tOplkError, CTL_RESULT_INVALID for a malformed request.
+   After CTL_SUBSCRIBE the client receives CTL_STREAM_PI (the process image
+   as exchanged with the stack) and/or CTL_STREAM_STATS every decimation
+   sync cycles, decimation 0 ends the subscription.
+
+   Messages are sent without blocking.  A client that does not keep up
+   loses messages and sees the count in ctl_stats_t.dropped, the main
+   loop never waits for it.  The sequence number of the stream messages
+   counts the messages of the client, sent or dropped. */
+
+#define CTLSOCK_MAX_CLIENTS  8
+#define CTLSOCK_MAX_REQUESTS 4    /* served per client and main loop pass */
+#define CTLSOCK_RING         64   /* process image snapshots, power of 2 */
+
+#define CTL_RESET            0x01
+#define CTL_STATS            0x02
+#define CTL_READ             0x03
+#define CTL_WRITE            0x04
+#define CTL_SUBSCRIBE        0x05
+#define CTL_REPLY            0x80
+#define CTL_STREAM_PI        0x90
+#define CTL_STREAM_STATS     0x91
+
+#define CTL_RESULT_INVALID   0xFFFFFFFF
+#define CTL_MAX_MSG          256
+#define CTL_MAX_DATA         64
+
+/* streams of CTL_SUBSCRIBE */
+#define CTL_SUB_PI           0x01
+#define CTL_SUB_STATS        0x02
+
+typedef struct __attribute__((packed)) {
+  UINT8  type;
+  UINT8  seq;
+} ctl_header_t;
+
+typedef struct __attribute__((packed)) {
+  ctl_header_t hdr;
+  UINT16 index;
+  UINT8  subindex;
+  UINT8  data[CTL_MAX_DATA];    /* CTL_WRITE only */
+} ctl_object_t;
+
+typedef struct __attribute__((packed)) {
+  ctl_header_t hdr;
+  UINT8  streams;
+  UINT16 decimation;
+} ctl_subscribe_t;
+
+typedef struct __attribute__((packed)) {
+  ctl_header_t hdr;
+  UINT32 result;
+  UINT8  data[CTL_MAX_DATA];    /* CTL_READ only */
+} ctl_result_t;
+
+typedef struct __attribute__((packed)) {
+  ctl_header_t hdr;
+  UINT32 cycle;                 /* sync cycles processed */
+  UINT8  active;                /* process data is exchanged */
+  UINT8  status;                /* APP_STATUS_* */
+  UINT16 event_age;
+  UINT16 poll_age;
+  UINT32 overruns;              /* snapshots the main loop missed */
+  UINT32 dropped;               /* messages to this client dropped */
+} ctl_stats_t;
+
+typedef struct __attribute__((packed)) {
+  ctl_header_t hdr;
+  UINT32 cycle;
+  UINT64 time_ns;               /* CLOCK_MONOTONIC of the sync */
+  joystick_state_t pi;
+} ctl_pi_t;
+
+/* returned by ctlsock_process() */
+#define CTLSOCK_REQ_RESET    0x01
+
+int  ctlsock_init(const char *path);
+void ctlsock_shutdown(void);
+int  ctlsock_fill_fds(fd_set *fds, int max_fd);
+int  ctlsock_process(fd_set *fds);
+void ctlsock_sync(const joystick_state_t *pi, UINT32 cycle, UINT64 sync_ns);
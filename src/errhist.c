@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <oplk/debugstr.h>
+#include "errhist.h"
+
+/* A slot holds entry n of the ring while seq is 2n + 2, it is odd while
+   the entry is written.  Writers take a slot with a compare and swap on
+   seq, so two writers a lap apart never write it at the same time. */
+typedef struct {
+  UINT32 seq;
+  UINT8  entry[ERRHIST_ENTRY_SIZE];
+} errhist_slot_t;
+
+static errhist_slot_t ring[ERRHIST_RING];
+static UINT32 head;                 /* entries claimed */
+static UINT32 commits;              /* entries completed */
+static UINT32 published;            /* commits at the last publish */
+static int publish_posted;          /* a publish event is queued */
+
+/* domain buffers linked with 0x1003, written in the stack's event thread */
+static UINT8 od_entries[ERRHIST_OD_ENTRIES][ERRHIST_ENTRY_SIZE];
+static UINT8 od_count;              /* 0x1003/00 */
+static int od_linked;
+
+/* active critical errors per bit of 0x1001 */
+static UINT32 reg_count[8];
+static UINT8 reg_written;
+static int reg_invalid;
+
+/* NetTime - CLOCK_MONOTONIC in ns, 0 until the first SoC */
+static INT64 clock_offset;
+
+static inline void put_le16(UINT8 *p, UINT16 v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static inline void put_le32(UINT8 *p, UINT32 v) {
+  put_le16(p, v);
+  put_le16(p + 2, v >> 16);
+}
+
+static void pack(UINT8 *p, UINT16 type, UINT16 code, const tNetTime *t,
+		 const void *info, size_t info_len) {
+  put_le16(p, type);
+  put_le16(p + 2, code);
+  put_le32(p + 4, t->sec);
+  put_le32(p + 8, t->nsec);
+  memset(p + 12, 0, 8);
+  if (info != NULL)
+    memcpy(p + 12, info, (info_len < 8) ? info_len : 8);
+}
+
+static void now(tNetTime *t) {
+  struct timespec ts;
+  INT64 offset = __atomic_load_n(&clock_offset, __ATOMIC_RELAXED);
+  UINT64 ns;
+
+  if (offset == 0) {
+    t->sec = t->nsec = 0;
+    return;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  ns = (UINT64)ts.tv_sec * 1000000000ULL + ts.tv_nsec + offset;
+  t->sec = ns / 1000000000ULL;
+  t->nsec = ns % 1000000000ULL;
+}
+
+/* Link the domain buffers with 0x1003, once the stack is up */
+int errhist_init(void) {
+  UINT entries = ERRHIST_OD_ENTRIES;
+  tObdSize size = ERRHIST_ENTRY_SIZE;
+  tOplkError ret;
+
+  ret = oplk_linkObject(0x1003, od_entries, &entries, &size, 0x01);
+  if (ret != kErrorOk) {
+    fprintf(stderr, "Linking ERR_History failed with \"%s\" (0x%04x)\n",
+	    debugstr_getRetValStr(ret), ret);
+    return -1;
+  }
+  od_linked = 1;
+  /* entries posted before are published with the next pass */
+  published = commits - 1;
+  publish_posted = 0;
+  reg_invalid = 1;
+  return 0;
+}
+
+/* Called by the sync path with the NetTime of the SoC and the monotonic
+   time it arrived, so that entries are stamped in NetTime. */
+void errhist_sync_clock(const tNetTime *soc, UINT64 soc_ns) {
+  UINT64 net_ns = (UINT64)soc->sec * 1000000000ULL + soc->nsec;
+
+  if (net_ns != 0)
+    __atomic_store_n(&clock_offset, (INT64)(net_ns - soc_ns), __ATOMIC_RELAXED);
+}
+
+/* Claim the slot of a new entry.  The ring has been lapped if the slot is
+   still written by the entry a lap before, or already taken by the entry a
+   lap after: the entry is dropped then and NULL returned. */
+static errhist_slot_t *claim(UINT32 *n) {
+  errhist_slot_t *slot;
+  UINT32 seq;
+
+  *n = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+  slot = &ring[*n & (ERRHIST_RING - 1)];
+  seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+  do {
+    if ((seq & 1) || ((INT32)(seq - 2 * *n) > 0))
+      return NULL;
+  } while (!__atomic_compare_exchange_n(&slot->seq, &seq, 2 * *n + 1, 1,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  return slot;
+}
+
+static void commit(errhist_slot_t *slot, UINT32 n) {
+  __atomic_store_n(&slot->seq, 2 * n + 2, __ATOMIC_RELEASE);
+  __atomic_fetch_add(&commits, 1, __ATOMIC_RELEASE);
+}
+
+/* Post an entry, time stamped now.  info_len bytes of info, up to 8, go
+   to the additional information of the entry. */
+void errhist_post(UINT16 type, UINT16 code, const void *info, size_t info_len) {
+  errhist_slot_t *slot;
+  tNetTime t;
+  UINT32 n;
+
+  now(&t);
+  if ((slot = claim(&n)) == NULL)
+    return;
+  pack(slot->entry, type, code, &t, info, info_len);
+  commit(slot, n);
+}
+
+/* Post an entry of the stack (kOplkApiEventHistoryEntry) as it is */
+void errhist_post_entry(const tErrHistoryEntry *entry) {
+  errhist_slot_t *slot;
+  UINT32 n;
+
+  if ((slot = claim(&n)) == NULL)
+    return;
+  pack(slot->entry, entry->entryType, entry->errorCode, &entry->timeStamp,
+       entry->aAddInfo, sizeof(entry->aAddInfo));
+  commit(slot, n);
+}
+
+/* A critical error occurred: post it and set the reg bits of 0x1001 until
+   errhist_clear() is called for it. */
+void errhist_raise(UINT16 code, UINT8 reg, const void *info, size_t info_len) {
+  int bit;
+
+  for (bit = 0; bit < 8; bit++)
+    if (reg & (1 << bit))
+      __atomic_fetch_add(&reg_count[bit], 1, __ATOMIC_RELAXED);
+  errhist_post(ERRHIST_STATUS | ERRHIST_OCCURRED | ERRHIST_PROFILE, code, info, info_len);
+}
+
+void errhist_clear(UINT16 code, UINT8 reg) {
+  int bit;
+
+  for (bit = 0; bit < 8; bit++)
+    if (reg & (1 << bit))
+      __atomic_fetch_sub(&reg_count[bit], 1, __ATOMIC_RELAXED);
+  errhist_post(ERRHIST_STATUS | ERRHIST_CLEARED | ERRHIST_PROFILE, code, NULL, 0);
+}
+
+/* The stack has reloaded the communication part, 0x1001 included */
+void errhist_reset_comm(void) {
+  __atomic_store_n(&reg_invalid, 1, __ATOMIC_RELAXED);
+}
+
+static UINT8 error_register(void) {
+  UINT8 reg = 0;
+  int bit;
+
+  for (bit = 0; bit < 8; bit++)
+    if (__atomic_load_n(&reg_count[bit], __ATOMIC_RELAXED) > 0)
+      reg |= 1 << bit;
+  return reg;
+}
+
+static void publish_register(void) {
+  UINT8 reg = error_register();
+
+  if ((reg == reg_written) && !__atomic_load_n(&reg_invalid, __ATOMIC_RELAXED))
+    return;
+  __atomic_store_n(&reg_invalid, 0, __ATOMIC_RELAXED);
+  if (oplk_writeLocalObject(0x1001, 0x00, &reg, sizeof(reg)) == kErrorOk)
+    __atomic_store_n(&reg_written, reg, __ATOMIC_RELAXED);
+}
+
+/* Copy the complete entries of the ring newest first into 0x1003 and set
+   0x1003/00 to their number.  Entries still being written are picked up
+   by the next pass, their commit triggers it. */
+static void publish_entries(void) {
+  errhist_slot_t *slot;
+  UINT32 h, n, seq;
+  unsigned int i = 0, k;
+  UINT8 count;
+
+  h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+  for (k = 0; (k < ERRHIST_RING) && (k < h) && (i < ERRHIST_OD_ENTRIES); k++) {
+    n = h - 1 - k;
+    slot = &ring[n & (ERRHIST_RING - 1)];
+    seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (seq != 2 * n + 2)
+      continue;
+    memcpy(od_entries[i], slot->entry, ERRHIST_ENTRY_SIZE);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq)
+      i++;
+  }
+  memset(od_entries[0] + i * ERRHIST_ENTRY_SIZE, 0, (ERRHIST_OD_ENTRIES - i) * ERRHIST_ENTRY_SIZE);
+  count = i;
+  if ((count != od_count) && (oplk_writeLocalObject(0x1003, 0x00, &count, sizeof(count)) == kErrorOk))
+    od_count = count;
+}
+
+/* Called from the main loop.  0x1001 and 0x1003 are updated in the event
+   thread of the stack, which serves the SDO reads of them, so that a read
+   never sees an entry half written: post an event if anything changed. */
+void errhist_publish(void) {
+  if (!od_linked || __atomic_load_n(&publish_posted, __ATOMIC_ACQUIRE))
+    return;
+  if ((__atomic_load_n(&commits, __ATOMIC_RELAXED) == __atomic_load_n(&published, __ATOMIC_RELAXED)) &&
+      (error_register() == __atomic_load_n(&reg_written, __ATOMIC_RELAXED)) &&
+      !__atomic_load_n(&reg_invalid, __ATOMIC_RELAXED))
+    return;
+  __atomic_store_n(&publish_posted, 1, __ATOMIC_RELAXED);
+  if (oplk_postUserEvent(&publish_posted) != kErrorOk)
+    __atomic_store_n(&publish_posted, 0, __ATOMIC_RELAXED);
+}
+
+/* User event of the stack, see errhist_publish() */
+void errhist_user_event(const void *arg) {
+  UINT32 c;
+
+  if (arg != &publish_posted)
+    return;
+  c = __atomic_load_n(&commits, __ATOMIC_ACQUIRE);
+  publish_register();
+  publish_entries();
+  __atomic_store_n(&published, c, __ATOMIC_RELAXED);
+  __atomic_store_n(&publish_posted, 0, __ATOMIC_RELEASE);
+}
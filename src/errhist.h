@@ -0,0 +1,56 @@
+#pragma once
+
+#include <oplk/oplk.h>
+
+/* Error history of the CN, exposed as 0x1003 ERR_History_ADOM.
+
+   Errors are posted from any thread (input loop, sync thread, stack event
+   callback) into a fixed-size ring without locking: a producer claims a
+   slot with an atomic increment and a compare and swap of its sequence
+   number, and marks it valid once the entry is complete.  A producer that
+   was lapped by ERRHIST_RING others drops its entry.
+
+   errhist_publish(), called from the main loop, posts a user event to the
+   stack when there is news.  errhist_user_event(), called with it in the
+   event thread of the stack, where SDO reads are served, copies the valid
+   entries newest first into the domain buffers of 0x1003, subindex 1 being
+   the most recent, and sets 0x1003/00 to their number.
+
+   Critical entries also set bits of 0x1001 ERR_ErrorRegister_U8 until they
+   are cleared, so that the MN sees them in the StatusResponse and, if it
+   maps 0x1001 into the PRes, within a cycle. */
+
+#define ERRHIST_OD_ENTRIES  10   /* subindexes of 0x1003 in objdict.h */
+#define ERRHIST_RING        16   /* power of 2, >= ERRHIST_OD_ENTRIES */
+
+/* entry type: bit 15 status entry, bits 12-13 mode, bits 0-11 profile */
+#define ERRHIST_STATUS      0x8000
+#define ERRHIST_OCCURRED    0x1000
+#define ERRHIST_CLEARED     0x2000
+#define ERRHIST_INFO        0x3000
+#define ERRHIST_PROFILE     0x0191  /* CiA 401 */
+
+/* error codes of the application, the stack posts its own */
+#define ERRHIST_INPUT_OPEN  0xFF01  /* input device cannot be opened */
+#define ERRHIST_INPUT_LOST  0xFF02  /* input device detached or read failed */
+#define ERRHIST_INPUT_STALE 0xFF03  /* input loop did not run for APP_STALE_MS */
+#define ERRHIST_SYNC        0xFF10  /* process image exchange failed */
+#define ERRHIST_STACK       0xFF20  /* stack error or warning event */
+
+/* bits of 0x1001 */
+#define ERRHIST_REG_GENERIC 0x01
+#define ERRHIST_REG_COMM    0x10
+#define ERRHIST_REG_PROFILE 0x20
+
+/* 0x1003 entry as sent on the network, little endian */
+#define ERRHIST_ENTRY_SIZE  20
+
+int  errhist_init(void);
+void errhist_sync_clock(const tNetTime *soc, UINT64 soc_ns);
+void errhist_post(UINT16 type, UINT16 code, const void *info, size_t info_len);
+void errhist_post_entry(const tErrHistoryEntry *entry);
+void errhist_raise(UINT16 code, UINT8 reg, const void *info, size_t info_len);
+void errhist_clear(UINT16 code, UINT8 reg);
+void errhist_reset_comm(void);
+void errhist_publish(void);
+void errhist_user_event(const void *arg);
@@ -0,0 +1,170 @@
+#include <fcntl.h>
+#include <linux/input.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+#include "input.h"
+
+/* evdev source, /dev/input/eventN.  Unlike joydev, evdev stamps its events
+   in the kernel: the clock is switched to CLOCK_MONOTONIC, so the stamps
+   are those of the sync path.
+
+   The buttons (keys from BTN_MISC on, then any other keys) are the digital
+   inputs in code order, ABS_X and ABS_Y the analogue inputs, scaled from
+   their range to INT16 like the axes of hidraw.  After SYN_DROPPED the
+   state is read back from the device. */
+
+#define EVDEV_UNMAPPED  0xFF
+#define BITS_PER_LONG   (8 * sizeof(unsigned long))
+#define TEST_BIT(bits, n) (((bits)[(n) / BITS_PER_LONG] >> ((n) % BITS_PER_LONG)) & 1)
+
+static const UINT16 evdev_axes[] = { ABS_X, ABS_Y };
+#define EVDEV_AXES  (sizeof(evdev_axes) / sizeof(evdev_axes[0]))
+
+typedef struct {
+  UINT8  key_input[KEY_CNT];    /* digital input of each key, or EVDEV_UNMAPPED */
+  UINT8  abs_input[ABS_CNT];    /* analogue input of each axis, or EVDEV_UNMAPPED */
+  INT32  abs_min[EVDEV_AXES];
+  INT32  abs_scale[EVDEV_AXES]; /* 16.16 factor from the range to INT16 */
+  int    dropped;               /* events lost, skip to the next SYN_REPORT */
+} evdev_t;
+
+static INT16 scale_abs(const evdev_t *ev, unsigned int n, INT32 value) {
+  INT64 out = (((INT64)(value - ev->abs_min[n]) * ev->abs_scale[n]) >> 16) - 32767;
+
+  out = out < -32767 ? -32767 : out;
+  out = out > 32767 ? 32767 : out;
+  return (INT16)out;
+}
+
+/* Apply the current state of the device, at t_ns or as initial state */
+static void evdev_sync_state(input_source_t *src, UINT64 t_ns) {
+  const evdev_t *ev = src->priv;
+  unsigned long keys[KEY_CNT / BITS_PER_LONG + 1];
+  struct input_absinfo abs;
+  unsigned int code;
+
+  memset(keys, 0, sizeof(keys));
+  if (ioctl(src->fd, EVIOCGKEY(sizeof(keys)), keys) >= 0) {
+    for (code = 0; code < KEY_CNT; code++)
+      if (ev->key_input[code] != EVDEV_UNMAPPED)
+	input_set_digital(src, ev->key_input[code], TEST_BIT(keys, code), t_ns);
+  }
+  for (code = 0; code < src->n_analogue; code++)
+    if (ioctl(src->fd, EVIOCGABS(evdev_axes[code]), &abs) >= 0)
+      input_set_analogue(src, code, scale_abs(ev, code, abs.value), t_ns);
+}
+
+static void map_keys(input_source_t *src, evdev_t *ev) {
+  unsigned long keys[KEY_CNT / BITS_PER_LONG + 1];
+  unsigned int code, pass;
+
+  memset(keys, 0, sizeof(keys));
+  if (ioctl(src->fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) < 0)
+    return;
+  /* joystick and gamepad buttons first, as joydev numbers them */
+  for (pass = 0; pass < 2; pass++) {
+    for (code = pass ? 0 : BTN_MISC; code < (pass ? BTN_MISC : KEY_CNT); code++) {
+      if (TEST_BIT(keys, code) && (src->n_digital < INPUT_DIGITAL))
+	ev->key_input[code] = src->n_digital++;
+    }
+  }
+}
+
+static void map_axes(input_source_t *src, evdev_t *ev) {
+  unsigned long abs_bits[ABS_CNT / BITS_PER_LONG + 1];
+  struct input_absinfo abs;
+  unsigned int i;
+
+  memset(abs_bits, 0, sizeof(abs_bits));
+  if (ioctl(src->fd, EVIOCGBIT(EV_ABS, sizeof(abs_bits)), abs_bits) < 0)
+    return;
+  /* the analogue inputs are positional, X before Y */
+  for (i = 0; i < EVDEV_AXES; i++) {
+    if (!TEST_BIT(abs_bits, evdev_axes[i]) ||
+	(ioctl(src->fd, EVIOCGABS(evdev_axes[i]), &abs) < 0) ||
+	((INT64)abs.maximum - abs.minimum < 2))    /* the scale would overflow */
+      break;
+    ev->abs_input[evdev_axes[i]] = i;
+    ev->abs_min[i] = abs.minimum;
+    ev->abs_scale[i] = (INT32)(((65534LL << 16) + ((INT64)abs.maximum - abs.minimum) - 1) /
+			       ((INT64)abs.maximum - abs.minimum));
+    src->n_analogue++;
+  }
+}
+
+static int evdev_open(input_source_t *src) {
+  int clock = CLOCK_MONOTONIC;
+  evdev_t *ev;
+
+  if ((ev = malloc(sizeof(*ev))) == NULL)
+    return -1;
+  memset(ev->key_input, EVDEV_UNMAPPED, sizeof(ev->key_input));
+  memset(ev->abs_input, EVDEV_UNMAPPED, sizeof(ev->abs_input));
+  ev->dropped = 0;
+  if ((src->fd = open(src->arg, O_RDONLY | O_CLOEXEC)) < 0) {
+    free(ev);
+    return -1;
+  }
+  src->priv = ev;
+  if (ioctl(src->fd, EVIOCGNAME(sizeof(src->name)), src->name) < 0)
+    src->name[0] = '\0';
+  if (ioctl(src->fd, EVIOCSCLOCKID, &clock) == 0)
+    src->caps |= INPUT_CAP_TIMESTAMP;
+
+  map_keys(src, ev);
+  map_axes(src, ev);
+  src->caps |= (src->n_digital ? INPUT_CAP_DIGITAL : 0) | (src->n_analogue ? INPUT_CAP_ANALOGUE : 0);
+  evdev_sync_state(src, 0);
+  return 0;
+}
+
+static void evdev_decode(input_source_t *src, const UINT8 *buf, size_t len, UINT64 read_ns) {
+  const struct input_event *e = (const struct input_event *)buf;
+  size_t n = len / sizeof(*e);
+  evdev_t *ev = src->priv;
+  UINT64 t;
+
+  for (; n > 0; n--, e++) {
+    TRACE_PROBE4(event_read, e->input_event_usec, e->type, e->code, e->value);
+    if (src->caps & INPUT_CAP_TIMESTAMP)
+      t = (UINT64)e->input_event_sec * 1000000000ULL + (UINT64)e->input_event_usec * 1000;
+    else
+      t = read_ns;
+    if (e->type == EV_SYN) {
+      if (e->code == SYN_DROPPED) {
+	ev->dropped = 1;
+      } else if ((e->code == SYN_REPORT) && ev->dropped) {
+	ev->dropped = 0;
+	evdev_sync_state(src, t);
+      }
+    } else if (ev->dropped) {
+      continue;
+    } else if ((e->type == EV_KEY) && (e->code < KEY_CNT) &&
+	       (ev->key_input[e->code] != EVDEV_UNMAPPED)) {
+      /* autorepeat (2) is no change */
+      if (e->value != 2)
+	input_set_digital(src, ev->key_input[e->code], e->value, t);
+    } else if ((e->type == EV_ABS) && (e->code < ABS_CNT) &&
+	       (ev->abs_input[e->code] != EVDEV_UNMAPPED)) {
+      input_set_analogue(src, ev->abs_input[e->code],
+			 scale_abs(ev, ev->abs_input[e->code], e->value), t);
+    }
+  }
+}
+
+static void evdev_close(input_source_t *src) {
+  close(src->fd);
+  free(src->priv);
+  src->priv = NULL;
+}
+
+const input_ops_t evdev_source = {
+  .type      = "evdev",
+  .read_size = INPUT_READ_MAX / sizeof(struct input_event) * sizeof(struct input_event),
+  .open      = evdev_open,
+  .decode    = evdev_decode,
+  .close     = evdev_close,
+};
@@ -42,10 +42,22 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // includes
 //------------------------------------------------------------------------------
 #include <stdio.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
 #include <oplk/oplk.h>
 #include <oplk/debugstr.h>
 
 #include "event.h"
+#include "app.h"
+#include "capture.h"
+#include "errhist.h"
+#include "syncmodel.h"
+#include "timeline.h"
+#include "trace.h"
+#if defined(CONFIG_APP_STORE_RESTORE)
+#include "obdstore.h"
+#endif
 
 
 //============================================================================//
@@ -59,7 +71,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //------------------------------------------------------------------------------
 // module global vars
 //------------------------------------------------------------------------------
-static BOOL*    pfGsOff_l;
+static BOOL*            pfGsOff_l;
+static pthread_mutex_t  gsOffMutex_l = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   gsOffCond_l;
+static struct timespec  resetTime_l;
+static BOOL             fResetPending_l = FALSE;
 
 //------------------------------------------------------------------------------
 // global function prototypes
@@ -90,6 +106,11 @@ static tOplkError processErrorWarningEvent(const tEventError* pInternalError_p,
                                            void* pUserArg_p);
 static tOplkError processPdoChangeEvent(const tOplkApiEventPdoChange* pPdoChange_p,
                                         void* pUserArg_p);
+static void       processCycleTiming(void);
+#if defined(CONFIG_APP_STORE_RESTORE)
+static tOplkError processObdAccessEvent(const tObdCbParam* pObdCbParam_p,
+                                        void* pUserArg_p);
+#endif
 
 //============================================================================//
 //            P U B L I C   F U N C T I O N S                                 //
@@ -109,7 +130,108 @@ The function initializes the applications event module
 //------------------------------------------------------------------------------
 void initEvents(BOOL* pfGsOff_p)
 {
+    pthread_condattr_t  condAttr;
+
     pfGsOff_l = pfGsOff_p;
+
+    // GsOff waits are timed against the monotonic clock
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&gsOffCond_l, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+}
+
+//------------------------------------------------------------------------------
+/**
+\brief  Clear the GsOff flag
+
+The function clears the GsOff flag before the application issues an NMT
+command which is expected to take the stack down.
+
+\ingroup module_demo_cn_console
+*/
+//------------------------------------------------------------------------------
+void clearGsOffEvent(void)
+{
+    pthread_mutex_lock(&gsOffMutex_l);
+    *pfGsOff_l = FALSE;
+    pthread_mutex_unlock(&gsOffMutex_l);
+}
+
+//------------------------------------------------------------------------------
+/**
+\brief  Check whether the stack is in GsOff
+
+\return The function returns TRUE if the event handler has received kNmtGsOff
+        since the flag was last cleared.
+
+\ingroup module_demo_cn_console
+*/
+//------------------------------------------------------------------------------
+BOOL checkGsOffEvent(void)
+{
+    BOOL    fGsOff;
+
+    pthread_mutex_lock(&gsOffMutex_l);
+    fGsOff = *pfGsOff_l;
+    pthread_mutex_unlock(&gsOffMutex_l);
+
+    return fGsOff;
+}
+
+//------------------------------------------------------------------------------
+/**
+\brief  Wait for the stack to reach GsOff
+
+The function blocks until the event handler has received kNmtGsOff or the
+timeout has expired.
+
+\param[in]      timeoutMs_p         Timeout in milliseconds
+
+\return The function returns TRUE if the stack is in state GsOff, otherwise FALSE.
+
+\ingroup module_demo_cn_console
+*/
+//------------------------------------------------------------------------------
+BOOL waitGsOffEvent(UINT timeoutMs_p)
+{
+    struct timespec deadline;
+    BOOL            fGsOff;
+    int             rc = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeoutMs_p / 1000;
+    deadline.tv_nsec += (long)(timeoutMs_p % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&gsOffMutex_l);
+    while (!*pfGsOff_l && (rc != ETIMEDOUT))
+        rc = pthread_cond_timedwait(&gsOffCond_l, &gsOffMutex_l, &deadline);
+    fGsOff = *pfGsOff_l;
+    pthread_mutex_unlock(&gsOffMutex_l);
+
+    return fGsOff;
+}
+
+//------------------------------------------------------------------------------
+/**
+\brief  Note that an NMT reset has been issued
+
+The function remembers the time of a software reset so that the event handler
+can report how long it took the node to get back to Operational. The time is
+published before the pending flag, which the event thread reads.
+
+\ingroup module_demo_cn_console
+*/
+//------------------------------------------------------------------------------
+void notifyNmtReset(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &resetTime_l);
+    __atomic_store_n(&fResetPending_l, TRUE, __ATOMIC_RELEASE);
 }
 
 //------------------------------------------------------------------------------
@@ -140,14 +262,37 @@ tOplkError processEvents(tOplkApiEventType eventType_p,
             break;
 
         case kOplkApiEventCriticalError:
+            errhist_post(ERRHIST_OCCURRED | ERRHIST_PROFILE, ERRHIST_STACK,
+                         &pEventArg_p->internalError, sizeof(pEventArg_p->internalError));
+            ret = processErrorWarningEvent(&pEventArg_p->internalError, pUserArg_p);
+            break;
+
         case kOplkApiEventWarning:
+            errhist_post(ERRHIST_INFO | ERRHIST_PROFILE, ERRHIST_STACK,
+                         &pEventArg_p->internalError, sizeof(pEventArg_p->internalError));
             ret = processErrorWarningEvent(&pEventArg_p->internalError, pUserArg_p);
             break;
 
+        case kOplkApiEventHistoryEntry:
+            // the stack leaves the error history to the application
+            errhist_post_entry(&pEventArg_p->errHistoryEntry);
+            break;
+
         case kOplkApiEventPdoChange:
             ret = processPdoChangeEvent(&pEventArg_p->pdoChange, pUserArg_p);
             break;
 
+        case kOplkApiEventUserDef:
+            // posted by errhist_publish() to update 0x1003 in this thread
+            errhist_user_event(pEventArg_p->pUserArg);
+            break;
+
+#if defined(CONFIG_APP_STORE_RESTORE)
+        case kOplkApiEventObdAccess:
+            ret = processObdAccessEvent(&pEventArg_p->obdCbParam, pUserArg_p);
+            break;
+#endif
+
         default:
             break;
     }
@@ -177,6 +322,7 @@ static tOplkError processStateChangeEvent(const tEventNmtStateChange* pNmtStateC
                                           void* pUserArg_p)
 {
     tOplkError  ret = kErrorOk;
+    BOOL        fActive;
 
     UNUSED_PARAMETER(pUserArg_p);
 
@@ -184,6 +330,20 @@ static tOplkError processStateChangeEvent(const tEventNmtStateChange* pNmtStateC
         return kErrorGeneralError;
 
     //    eventlog_printStateEvent(pNmtStateChange_p);
+    timeline_mark(debugstr_getNmtStateStr(pNmtStateChange_p->newNmtState));
+    TRACE_PROBE3(nmt_state_change,
+                 pNmtStateChange_p->oldNmtState,
+                 pNmtStateChange_p->newNmtState,
+                 pNmtStateChange_p->nmtEvent);
+
+    // process data is only exchanged in ReadyToOperate and Operational,
+    // in the other states the sync processing sleeps and the inputs are
+    // drained at a low rate
+    fActive = (pNmtStateChange_p->newNmtState == kNmtCsReadyToOperate) ||
+              (pNmtStateChange_p->newNmtState == kNmtCsOperational);
+    app_set_active(fActive);
+    syncmodel_set_active(fActive);
+    capture_set_nmt_state(pNmtStateChange_p->newNmtState);
 
     switch (pNmtStateChange_p->newNmtState)
     {
@@ -194,19 +354,68 @@ static tOplkError processStateChangeEvent(const tEventNmtStateChange* pNmtStateC
             printf("Stack received kNmtGsOff!\n");
 
             // signal that stack is off
+            pthread_mutex_lock(&gsOffMutex_l);
             *pfGsOff_l = TRUE;
+            pthread_cond_broadcast(&gsOffCond_l);
+            pthread_mutex_unlock(&gsOffMutex_l);
             break;
 
-        case kNmtGsInitialising:
+        case kNmtCsOperational:
+            if (__atomic_exchange_n(&fResetPending_l, FALSE, __ATOMIC_ACQUIRE))
+            {
+                struct timespec now;
+
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                printf("Reset to Operational took %ld us\n",
+                       (long)(now.tv_sec - resetTime_l.tv_sec) * 1000000L +
+                       (now.tv_nsec - resetTime_l.tv_nsec) / 1000L);
+            }
+            timeline_report();
+            printf("Stack entered state: %s\n",
+                   debugstr_getNmtStateStr(pNmtStateChange_p->newNmtState));
+            break;
+
+        case kNmtCsReadyToOperate:
+            // the MN has finished the configuration of the cycle timing
+            printf("Stack entered state: %s\n",
+                   debugstr_getNmtStateStr(pNmtStateChange_p->newNmtState));
+            processCycleTiming();
+            break;
+
+#if defined(CONFIG_APP_STORE_RESTORE)
         case kNmtGsResetApplication:
+            // the stack has just loaded the default values of the
+            // manufacturer and device part, put the stored ones back
+            obdstore_restore(OBDSTORE_PART_MANUFACTURER | OBDSTORE_PART_DEVICE);
+            printf("Stack entered state: %s\n",
+                   debugstr_getNmtStateStr(pNmtStateChange_p->newNmtState));
+            break;
+
+        case kNmtGsResetCommunication:
+            // same for the communication part, before the stack
+            // applies it in kNmtGsResetConfiguration
+            obdstore_restore(OBDSTORE_PART_GENERIC);
+            printf("Stack entered state: %s\n",
+                   debugstr_getNmtStateStr(pNmtStateChange_p->newNmtState));
+            break;
+#endif
+
         case kNmtGsResetConfiguration:
+            // 0x1001 has been reset with the communication part
+            errhist_reset_comm();
+            printf("Stack entered state: %s\n",
+                   debugstr_getNmtStateStr(pNmtStateChange_p->newNmtState));
+            break;
+
+        case kNmtGsInitialising:
+#if !defined(CONFIG_APP_STORE_RESTORE)
+        case kNmtGsResetApplication:
         case kNmtGsResetCommunication:
+#endif
         case kNmtCsNotActive:               // Implement
         case kNmtCsPreOperational1:         // handling of
         case kNmtCsStopped:                 // different
         case kNmtCsPreOperational2:         // states here
-        case kNmtCsReadyToOperate:
-        case kNmtCsOperational:
         case kNmtCsBasicEthernet:           // no break;
 
         default:
@@ -267,6 +476,12 @@ static tOplkError processPdoChangeEvent(const tOplkApiEventPdoChange* pPdoChange
     UNUSED_PARAMETER(pUserArg_p);
 
     //eventlog_printPdoEvent(pPdoChange_p);
+    TRACE_PROBE5(pdo_change,
+                 pPdoChange_p->fActivated,
+                 pPdoChange_p->fTx,
+                 pPdoChange_p->nodeId,
+                 pPdoChange_p->mappParamIndex,
+                 pPdoChange_p->mappObjectCount);
 
     for (subIndex = 1; subIndex <= pPdoChange_p->mappObjectCount; subIndex++)
     {
@@ -290,4 +505,91 @@ static tOplkError processPdoChangeEvent(const tOplkApiEventPdoChange* pPdoChange
     return kErrorOk;
 }
 
+//------------------------------------------------------------------------------
+/**
+\brief  Apply the cycle timing configured by the MN
+
+The function reads back the cycle length 0x1006 NMT_CycleLen_U32, over
+which the axis predictor extrapolates, the multiplexed cycle count
+0x1F98/07 and the cycle assigned to this node in 0x1F9B
+NMT_MultiplCycleAssign_AU8.  A
+multiplexed CN only sends its PRes in the assigned cycle, but the stack
+does not pass the multiplexed cycle number to the application, so the
+process image keeps being exchanged in every sync.
+
+With PRes chaining the PRes is sent at PResTimeFirst 0x1F98/0B after the
+SoC, which replaces the PRes offset of the axis predictor.
+*/
+//------------------------------------------------------------------------------
+static void processCycleTiming(void)
+{
+    UINT8       nodeId;
+    UINT8       cycleCnt;
+    UINT8       cycleNo = 0;
+    UINT32      cycleLen;
+#if defined(CONFIG_DLL_PRES_CHAINING_CN)
+    UINT32      presTimeFirst;
+#endif
+    size_t      varLen;
+
+    varLen = sizeof(cycleLen);
+    if (oplk_readLocalObject(0x1006, 0x00, &cycleLen, &varLen) == kErrorOk)
+        app_set_cycle_len(cycleLen);
+    else
+        fprintf(stderr, "Cannot read the cycle length 0x1006\n");
+
+    varLen = sizeof(nodeId);
+    if (oplk_readLocalObject(0x1F93, 0x01, &nodeId, &varLen) != kErrorOk)
+        return;
+    varLen = sizeof(cycleCnt);
+    if (oplk_readLocalObject(0x1F98, 0x07, &cycleCnt, &varLen) != kErrorOk)
+        cycleCnt = 0;
+    varLen = sizeof(cycleNo);
+    if (oplk_readLocalObject(0x1F9B, nodeId, &cycleNo, &varLen) != kErrorOk)
+        cycleNo = 0;
+
+    if (cycleNo == 0)
+        printf("Continuous CN\n");
+    else if (cycleNo > cycleCnt)
+        fprintf(stderr, "Multiplexed cycle %u is beyond the %u cycles of 0x1F98/07\n",
+                cycleNo, cycleCnt);
+    else
+        printf("Multiplexed CN, cycle %u of %u\n", cycleNo, cycleCnt);
+
+#if defined(CONFIG_DLL_PRES_CHAINING_CN)
+    // without chaining the PRes offset of the command line applies again
+    varLen = sizeof(presTimeFirst);
+    if (oplk_readLocalObject(0x1F98, 0x0B, &presTimeFirst, &varLen) != kErrorOk)
+        presTimeFirst = 0;
+    if (presTimeFirst != 0)
+        printf("PRes chaining, PRes sent %lu ns after the SoC\n",
+               (unsigned long)presTimeFirst);
+    app_set_pres_offset(presTimeFirst);
+#endif
+}
+
+#if defined(CONFIG_APP_STORE_RESTORE)
+//------------------------------------------------------------------------------
+/**
+\brief  Process object access events
+
+The function processes object access events.  Writes to 0x1010
+NMT_StoreParam_REC and 0x1011 NMT_RestoreDefParam_REC are forwarded to the
+OD store.
+
+\param[in]      pObdCbParam_p       Pointer to the OD access parameters
+\param[in]      pUserArg_p          User specific argument
+
+\return The function returns a tOplkError error code.
+*/
+//------------------------------------------------------------------------------
+static tOplkError processObdAccessEvent(const tObdCbParam* pObdCbParam_p,
+                                        void* pUserArg_p)
+{
+    UNUSED_PARAMETER(pUserArg_p);
+
+    return obdstore_processObdAccess(pObdCbParam_p);
+}
+#endif
+
 /// \}
@@ -61,6 +61,10 @@ extern "C"
 #endif
 
 void        initEvents(BOOL* pfGsOff_p);
+void        clearGsOffEvent(void);
+BOOL        checkGsOffEvent(void);
+BOOL        waitGsOffEvent(UINT timeoutMs_p);
+void        notifyNmtReset(void);
 tOplkError  processEvents(tOplkApiEventType eventType_p,
                           const tOplkApiEventArg* pEventArg_p,
                           void* pUserArg_p);
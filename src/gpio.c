@@ -0,0 +1,207 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include "input.h"
+
+/* GPIO source: discrete buttons on the lines of a GPIO chip, read through
+   the line request API (v2) of the GPIO character device.  The argument is
+
+     CHIP:LINES[:DEBOUNCE_US]
+
+   with CHIP a device node or a name under /dev, LINES the line offsets,
+   comma separated, as ranges or with '!' for active low, e.g.
+
+     -i gpio:gpiochip0:4-7,!12:5000@8
+
+   maps lines 4 to 7 and the inverted line 12 to 0x6000/02 bits 0 to 4.
+   Line n of the list is digital input n.
+
+   The kernel queues an event with a CLOCK_MONOTONIC time stamp for every
+   edge, the clock of the sync path, so a button press is stamped when it
+   happened rather than when it was read.  The events are read in batches
+   from the line request fd.  If the kernel queue overflowed, which shows
+   as a gap in the sequence numbers, the line values are read back.
+
+   To try it without hardware, gpio-sim provides a chip whose line levels
+   can be set through configfs and sysfs, see the gpio-sim documentation
+   of the kernel: create a bank, enable it, and drive a line with
+
+     echo pull-up > /sys/devices/platform/gpio-sim.0/gpiochipN/sim_gpio4/pull */
+
+#define GPIO_CONSUMER  "powerlink-cn-joystick"
+
+typedef struct {
+  unsigned int n_lines;
+  UINT32       offsets[INPUT_DIGITAL];
+  UINT32       next_seqno;          /* expected of the next event, 0 if none yet */
+} gpio_src_t;
+
+/* Parse the line list into the request and the mask of the active low
+   lines, returns -1 if it is invalid */
+static int parse_lines(const char *list, gpio_src_t *gpio, struct gpio_v2_line_request *req,
+		       UINT64 *active_low_mask) {
+  unsigned long first, last, offset;
+  const char *p = list;
+  char *end;
+  int active_low;
+
+  while (*p != '\0') {
+    active_low = (*p == '!');
+    p += active_low;
+    first = strtoul(p, &end, 10);
+    if (end == p)
+      return -1;
+    last = first;
+    if (*end == '-') {
+      p = end + 1;
+      last = strtoul(p, &end, 10);
+      if ((end == p) || (last < first))
+	return -1;
+    }
+    for (offset = first; offset <= last; offset++) {
+      if (gpio->n_lines == INPUT_DIGITAL)
+	return -1;
+      if (active_low)
+	*active_low_mask |= 1ULL << gpio->n_lines;
+      gpio->offsets[gpio->n_lines] = offset;
+      req->offsets[gpio->n_lines++] = offset;
+    }
+    if (*end == ',')
+      end++;
+    else if (*end != '\0')
+      return -1;
+    p = end;
+  }
+  return (gpio->n_lines > 0) ? 0 : -1;
+}
+
+/* Apply the current line values, at t_ns or as initial state */
+static int gpio_sync_state(input_source_t *src, UINT64 t_ns) {
+  const gpio_src_t *gpio = src->priv;
+  struct gpio_v2_line_values values;
+
+  values.mask = (gpio->n_lines < 64) ? (1ULL << gpio->n_lines) - 1 : ~0ULL;
+  values.bits = 0;
+  if (ioctl(src->fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0)
+    return -1;
+  input_set_digital_bits(src, values.bits, gpio->n_lines, t_ns);
+  return 0;
+}
+
+static int gpio_open(input_source_t *src) {
+  struct gpio_v2_line_request req;
+  struct gpiochip_info info;
+  char arg[sizeof(src->arg)], chip[sizeof(src->arg) + 5], *lines, *debounce;
+  unsigned long debounce_us = 0;
+  UINT64 active_low = 0;
+  gpio_src_t *gpio;
+  int chip_fd, n_attrs = 0;
+
+  strncpy(arg, src->arg, sizeof(arg));
+  if ((lines = strchr(arg, ':')) == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+  *lines++ = '\0';
+  if ((debounce = strchr(lines, ':')) != NULL) {
+    *debounce++ = '\0';
+    debounce_us = strtoul(debounce, NULL, 10);
+  }
+  snprintf(chip, sizeof(chip), "%s%s", (arg[0] == '/') ? "" : "/dev/", arg);
+
+  if ((gpio = calloc(1, sizeof(*gpio))) == NULL)
+    return -1;
+  memset(&req, 0, sizeof(req));
+  if (parse_lines(lines, gpio, &req, &active_low) < 0) {
+    fprintf(stderr, "%s: invalid GPIO lines \"%s\"\n", src->arg, lines);
+    free(gpio);
+    errno = EINVAL;
+    return -1;
+  }
+  /* the kernel swaps the edges of active low lines too */
+  if (active_low != 0) {
+    req.config.attrs[n_attrs].attr.id = GPIO_V2_LINE_ATTR_ID_FLAGS;
+    req.config.attrs[n_attrs].attr.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_ACTIVE_LOW |
+      GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    req.config.attrs[n_attrs].mask = active_low;
+    n_attrs++;
+  }
+  if (debounce_us > 0) {
+    req.config.attrs[n_attrs].attr.id = GPIO_V2_LINE_ATTR_ID_DEBOUNCE;
+    req.config.attrs[n_attrs].attr.debounce_period_us = debounce_us;
+    req.config.attrs[n_attrs].mask = (1ULL << gpio->n_lines) - 1;
+    n_attrs++;
+  }
+  req.config.num_attrs = n_attrs;
+  req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING |
+    GPIO_V2_LINE_FLAG_EDGE_FALLING;
+  req.num_lines = gpio->n_lines;
+  strncpy(req.consumer, GPIO_CONSUMER, sizeof(req.consumer) - 1);
+
+  if ((chip_fd = open(chip, O_RDONLY | O_CLOEXEC)) < 0) {
+    free(gpio);
+    return -1;
+  }
+  if (ioctl(chip_fd, GPIO_GET_CHIPINFO_IOCTL, &info) == 0)
+    snprintf(src->name, sizeof(src->name), "%s [%s], %u lines", info.name, info.label,
+	     gpio->n_lines);
+  if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+    close(chip_fd);
+    free(gpio);
+    return -1;
+  }
+  close(chip_fd);
+
+  src->fd = req.fd;
+  src->priv = gpio;
+  src->n_digital = gpio->n_lines;
+  src->caps = INPUT_CAP_DIGITAL | INPUT_CAP_TIMESTAMP;
+  gpio_sync_state(src, 0);
+  return 0;
+}
+
+static void gpio_decode(input_source_t *src, const UINT8 *buf, size_t len, UINT64 read_ns) {
+  const struct gpio_v2_line_event *e = (const struct gpio_v2_line_event *)buf;
+  size_t n = len / sizeof(*e);
+  gpio_src_t *gpio = src->priv;
+  unsigned int i;
+
+  UNUSED_PARAMETER(read_ns);
+  for (; n > 0; n--, e++) {
+    TRACE_PROBE4(event_read, e->seqno, e->id, e->offset, e->line_seqno);
+    /* Events were lost, the levels may be other than the edges tell.  The
+       levels read now are as new as the last event queued, the rest of the
+       batch is older. */
+    if ((gpio->next_seqno != 0) && (e->seqno != gpio->next_seqno)) {
+      gpio->next_seqno = e->seqno + n;
+      gpio_sync_state(src, e->timestamp_ns);
+      return;
+    }
+    gpio->next_seqno = e->seqno + 1;
+    for (i = 0; i < gpio->n_lines; i++) {
+      if (gpio->offsets[i] == e->offset) {
+	input_set_digital(src, i, e->id == GPIO_V2_LINE_EVENT_RISING_EDGE, e->timestamp_ns);
+	break;
+      }
+    }
+  }
+}
+
+static void gpio_close(input_source_t *src) {
+  close(src->fd);
+  free(src->priv);
+  src->priv = NULL;
+}
+
+const input_ops_t gpio_source = {
+  .type      = "gpio",
+  .read_size = INPUT_READ_MAX / sizeof(struct gpio_v2_line_event) * sizeof(struct gpio_v2_line_event),
+  .open      = gpio_open,
+  .decode    = gpio_decode,
+  .close     = gpio_close,
+};
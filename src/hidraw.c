@@ -0,0 +1,375 @@
+#include <endian.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/hidraw.h>
+#include "hidraw.h"
+#include "input.h"
+
+/* HID report descriptor item types and tags (HID 1.11, 6.2.2) */
+#define ITEM_MAIN             0
+#define ITEM_GLOBAL           1
+#define ITEM_LOCAL            2
+#define ITEM_LONG             0xFE
+
+#define MAIN_INPUT            0x8
+#define GLOBAL_USAGE_PAGE     0x0
+#define GLOBAL_LOGICAL_MIN    0x1
+#define GLOBAL_LOGICAL_MAX    0x2
+#define GLOBAL_REPORT_SIZE    0x7
+#define GLOBAL_REPORT_ID      0x8
+#define GLOBAL_REPORT_COUNT   0x9
+#define GLOBAL_PUSH           0xA
+#define GLOBAL_POP            0xB
+#define LOCAL_USAGE           0x0
+#define LOCAL_USAGE_MIN       0x1
+#define LOCAL_USAGE_MAX       0x2
+
+#define INPUT_CONSTANT        0x01
+#define INPUT_VARIABLE        0x02
+
+#define PAGE_GENERIC_DESKTOP  0x01
+#define PAGE_BUTTON           0x09
+#define USAGE_X               0x30
+#define USAGE_Y               0x31
+
+#define MAX_USAGES            32
+#define MAX_GLOBAL_STACK      4
+#define MAX_BUTTONS           16
+
+typedef struct {
+  UINT32 usage_page;
+  INT32  logical_min;
+  INT32  logical_max;
+  UINT32 logical_max_u;
+  UINT32 report_size;
+  UINT32 report_count;
+  UINT8  report_id;
+} global_state_t;
+
+typedef struct {
+  UINT32       usages[MAX_USAGES];
+  unsigned int n_usages;
+  UINT32       usage_min;
+  UINT32       usage_max;
+  int          have_range;
+} local_state_t;
+
+static UINT32 local_usage(const local_state_t *local, const global_state_t *global,
+			  unsigned int i, unsigned int size) {
+  UINT32 usage;
+
+  if (local->have_range)
+    usage = (local->usage_min + i < local->usage_max) ? local->usage_min + i : local->usage_max;
+  else if (local->n_usages == 0)
+    return 0;
+  else if (i < local->n_usages)
+    usage = local->usages[i];
+  else
+    usage = local->usages[local->n_usages - 1];
+
+  /* 4 byte usages carry their own usage page */
+  if (size < 4 && !(usage >> 16))
+    usage |= global->usage_page << 16;
+  return usage;
+}
+
+static void add_button(hidraw_plan_t *plan, unsigned int bit, unsigned int button) {
+  hidraw_field_t *f;
+  unsigned int f_width;
+
+  /* extend the previous field if this button is the next bit */
+  if (plan->n_button_fields > 0) {
+    f = &plan->button_fields[plan->n_button_fields - 1];
+    f_width = __builtin_popcount(f->mask);
+    if ((f->byte_offset * 8u + f->bit_shift + f_width == bit) &&
+	(f->dest + f_width == button)) {
+      f->mask = (f->mask << 1) | 1;
+      return;
+    }
+  }
+  if (plan->n_button_fields == HIDRAW_MAX_BUTTON_FIELDS)
+    return;
+  f = &plan->button_fields[plan->n_button_fields++];
+  memset(f, 0, sizeof(*f));
+  f->byte_offset = bit / 8;
+  f->bit_shift = bit % 8;
+  f->dest = button;
+  f->mask = 1;
+}
+
+static void add_axis(hidraw_plan_t *plan, const global_state_t *global,
+		     unsigned int bit, unsigned int axis) {
+  hidraw_field_t *f;
+  INT64 min, max;
+  unsigned int i;
+
+  for (i = 0; i < plan->n_axes; i++)
+    if (plan->axes[i].dest == axis)
+      return;
+
+  min = global->logical_min;
+  /* a positive logical range is often encoded with its top bit set */
+  max = (min >= 0) ? (INT64)global->logical_max_u : global->logical_max;
+  /* the 16.16 scale of a range below 2 does not fit INT32 */
+  if ((max - min < 2) || (global->report_size < 2) || (global->report_size > 24))
+    return;
+
+  f = &plan->axes[plan->n_axes++];
+  f->byte_offset = bit / 8;
+  f->bit_shift = bit % 8;
+  f->dest = axis;
+  f->mask = (1u << global->report_size) - 1;
+  f->sign = (min < 0) ? 1u << (global->report_size - 1) : 0;
+  f->logical_min = (INT32)min;
+  f->scale = (INT32)(((65534LL << 16) + (max - min) - 1) / (max - min));
+}
+
+static void add_input(hidraw_plan_t *plan, const global_state_t *global,
+		      const local_state_t *local, unsigned int usage_size,
+		      unsigned int bit) {
+  unsigned int i;
+  UINT32 usage;
+
+  for (i = 0; i < global->report_count; i++, bit += global->report_size) {
+    usage = local_usage(local, global, i, usage_size);
+    if ((usage >> 16) == PAGE_BUTTON) {
+      if (global->report_size == 1 && (usage & 0xFFFF) >= 1 && (usage & 0xFFFF) <= MAX_BUTTONS) {
+	add_button(plan, bit, (usage & 0xFFFF) - 1);
+	plan->n_buttons++;
+      }
+    } else if (usage == ((PAGE_GENERIC_DESKTOP << 16) | USAGE_X)) {
+      add_axis(plan, global, bit, 0);
+    } else if (usage == ((PAGE_GENERIC_DESKTOP << 16) | USAGE_Y)) {
+      add_axis(plan, global, bit, 1);
+    }
+  }
+}
+
+/* Parse a HID report descriptor into an extraction plan for the first input
+   report that carries buttons or axes.  Returns 0 on success, -1 if the
+   descriptor maps nothing or its report does not fit HIDRAW_MAX_REPORT. */
+int hidraw_compile_plan(const UINT8 *desc, unsigned int desc_size, hidraw_plan_t *plan) {
+  global_state_t global, stack[MAX_GLOBAL_STACK];
+  local_state_t local;
+  UINT32 offsets[256];          /* input report length per report ID, in bits */
+  unsigned int depth = 0, pos = 0, size, usage_size = 0;
+  int have_plan = 0, uses_ids = 0;
+  UINT32 u;
+  INT32 s;
+  UINT8 prefix, type, tag;
+
+  memset(plan, 0, sizeof(*plan));
+  memset(&global, 0, sizeof(global));
+  memset(&local, 0, sizeof(local));
+  memset(offsets, 0, sizeof(offsets));
+
+  while (pos < desc_size) {
+    prefix = desc[pos++];
+    if (prefix == ITEM_LONG) {
+      if (pos + 2 > desc_size)
+	break;
+      pos += 2 + desc[pos];
+      continue;
+    }
+    size = (prefix & 3) == 3 ? 4 : (prefix & 3);
+    type = (prefix >> 2) & 3;
+    tag = prefix >> 4;
+    if (pos + size > desc_size)
+      break;
+
+    u = 0;
+    memcpy(&u, desc + pos, size);
+    u = le32toh(u);
+    pos += size;
+    s = (size == 0 || size == 4) ? (INT32)u :
+        (INT32)(u << (32 - 8 * size)) >> (32 - 8 * size);
+
+    switch (type) {
+    case ITEM_MAIN:
+      if (tag == MAIN_INPUT) {
+	UINT32 bit = offsets[global.report_id];
+
+	offsets[global.report_id] += global.report_size * global.report_count;
+	if (!(u & INPUT_CONSTANT) && (u & INPUT_VARIABLE) &&
+	    (!have_plan || plan->report_id == global.report_id)) {
+	  plan->report_id = global.report_id;
+	  add_input(plan, &global, &local, usage_size, bit);
+	  have_plan = (plan->n_button_fields + plan->n_axes) > 0;
+	}
+      }
+      memset(&local, 0, sizeof(local));
+      break;
+
+    case ITEM_GLOBAL:
+      switch (tag) {
+      case GLOBAL_USAGE_PAGE:   global.usage_page = u & 0xFFFF; break;
+      case GLOBAL_LOGICAL_MIN:  global.logical_min = s; break;
+      case GLOBAL_LOGICAL_MAX:  global.logical_max = s; global.logical_max_u = u; break;
+      case GLOBAL_REPORT_SIZE:  global.report_size = u; break;
+      case GLOBAL_REPORT_COUNT: global.report_count = u; break;
+      case GLOBAL_REPORT_ID:
+	global.report_id = u;
+	uses_ids = 1;
+	/* reports with an ID start with the ID byte */
+	if (offsets[global.report_id] == 0)
+	  offsets[global.report_id] = 8;
+	break;
+      case GLOBAL_PUSH:
+	if (depth < MAX_GLOBAL_STACK)
+	  stack[depth++] = global;
+	break;
+      case GLOBAL_POP:
+	if (depth > 0)
+	  global = stack[--depth];
+	break;
+      }
+      break;
+
+    case ITEM_LOCAL:
+      switch (tag) {
+      case LOCAL_USAGE:
+	if (local.n_usages < MAX_USAGES)
+	  local.usages[local.n_usages++] = u;
+	usage_size = size;
+	break;
+      case LOCAL_USAGE_MIN:
+	local.usage_min = u;
+	local.have_range = 1;
+	usage_size = size;
+	break;
+      case LOCAL_USAGE_MAX:
+	local.usage_max = u;
+	break;
+      }
+      break;
+    }
+  }
+
+  if (!have_plan)
+    return -1;
+  if (plan->report_id == 0 && uses_ids)
+    return -1;
+  plan->report_size = (offsets[plan->report_id] + 7) / 8;
+  if (plan->report_size > HIDRAW_MAX_REPORT)
+    return -1;
+  return 0;
+}
+
+int hidraw_probe(int fd, hidraw_plan_t *plan, char *name, unsigned int name_size) {
+  struct hidraw_report_descriptor desc;
+  int size;
+
+  if (name != NULL && ioctl(fd, HIDIOCGRAWNAME(name_size), name) < 0)
+    strncpy(name, "Unknown", name_size);
+  if (ioctl(fd, HIDIOCGRDESCSIZE, &size) < 0)
+    return -1;
+  desc.size = size;
+  if (ioctl(fd, HIDIOCGRDESC, &desc) < 0)
+    return -1;
+  return hidraw_compile_plan(desc.value, desc.size, plan);
+}
+
+int hidraw_is_device(const char *path) {
+  const char *base = strrchr(path, '/');
+
+  base = base ? base + 1 : path;
+  return strncmp(base, "hidraw", 6) == 0;
+}
+
+static inline UINT32 extract(const UINT8 *report, const hidraw_field_t *f) {
+  UINT64 raw;
+
+  memcpy(&raw, report + f->byte_offset, sizeof(raw));
+  return (UINT32)(le64toh(raw) >> f->bit_shift) & f->mask;
+}
+
+static inline INT16 scale_axis(const hidraw_field_t *f, UINT32 raw) {
+  INT32 v = (INT32)((raw ^ f->sign) - f->sign);
+  INT64 out = (((INT64)(v - f->logical_min) * f->scale) >> 16) - 32767;
+
+  out = out < -32767 ? -32767 : out;
+  out = out > 32767 ? 32767 : out;
+  return (INT16)out;
+}
+
+/* Decode one raw input report into the button bits and the axes of the
+   plan, the others are left alone.  The report buffer must be readable
+   HIDRAW_REPORT_PAD bytes past len.  Returns 1 if the report was decoded,
+   0 if it is a different report or too short. */
+int hidraw_decode(const hidraw_plan_t *plan, const UINT8 *report, unsigned int len,
+		  UINT32 *buttons, INT16 *axes) {
+  UINT32 bits = 0;
+  unsigned int i;
+
+  if ((len < plan->report_size) ||
+      ((plan->report_id != 0) && (report[0] != plan->report_id)))
+    return 0;
+
+  for (i = 0; i < plan->n_button_fields; i++)
+    bits |= extract(report, &plan->button_fields[i]) << plan->button_fields[i].dest;
+  for (i = 0; i < plan->n_axes; i++)
+    axes[plan->axes[i].dest] = scale_axis(&plan->axes[i], extract(report, &plan->axes[i]));
+
+  if (plan->n_buttons > 0)
+    *buttons = bits;
+  return 1;
+}
+
+/* hidraw source, /dev/hidrawN.  Button n of the report is digital input n,
+   X and Y the analogue inputs 0 and 1.  The reports carry no time stamp,
+   they are stamped when read. */
+static int hidraw_open(input_source_t *src) {
+  hidraw_plan_t *plan;
+
+  if ((plan = malloc(sizeof(*plan))) == NULL)
+    return -1;
+  if ((src->fd = open(src->arg, O_RDONLY | O_CLOEXEC)) < 0) {
+    free(plan);
+    return -1;
+  }
+  if (hidraw_probe(src->fd, plan, src->name, sizeof(src->name)) < 0) {
+    close(src->fd);
+    free(plan);
+    errno = ENOEXEC;            /* no usable input report */
+    return -1;
+  }
+  src->priv = plan;
+  src->n_digital = (plan->n_buttons > 0) ? MAX_BUTTONS : 0;
+  src->n_analogue = plan->n_axes ? HIDRAW_MAX_AXES : 0;
+  src->caps = (plan->n_buttons ? INPUT_CAP_DIGITAL : 0) | (plan->n_axes ? INPUT_CAP_ANALOGUE : 0);
+  return 0;
+}
+
+/* one complete input report per read() */
+static void hidraw_source_decode(input_source_t *src, const UINT8 *buf, size_t len,
+				 UINT64 read_ns) {
+  const hidraw_plan_t *plan = src->priv;
+  INT16 axes[HIDRAW_MAX_AXES] = { 0 };
+  UINT32 buttons = 0;
+  unsigned int i;
+
+  TRACE_PROBE4(event_read, 0, buf[0], 0, len);
+  if (!hidraw_decode(plan, buf, len, &buttons, axes))
+    return;
+  input_set_digital_bits(src, buttons, src->n_digital, read_ns);
+  for (i = 0; i < plan->n_axes; i++)
+    input_set_analogue(src, plan->axes[i].dest, axes[plan->axes[i].dest], read_ns);
+}
+
+static void hidraw_close(input_source_t *src) {
+  close(src->fd);
+  free(src->priv);
+  src->priv = NULL;
+}
+
+const input_ops_t hidraw_source = {
+  .type      = "hidraw",
+  .read_size = HIDRAW_MAX_REPORT,
+  .open      = hidraw_open,
+  .decode    = hidraw_source_decode,
+  .close     = hidraw_close,
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <oplk/oplk.h>
+
+/* hidraw input backend.  The HID report descriptor is parsed once into an
+   extraction plan: byte offset, shift and mask of every field that maps to
+   the process image.  Each raw input report is then decoded by walking the
+   plan with branch-free bit extraction. */
+
+#define HIDRAW_MAX_REPORT       256 /* largest input report decoded */
+#define HIDRAW_REPORT_PAD       8   /* slack after a report for 64 bit loads */
+#define HIDRAW_MAX_BUTTON_FIELDS 16
+#define HIDRAW_MAX_AXES         2
+
+typedef struct {
+  UINT16 byte_offset;  /* first byte of the field in the report */
+  UINT8  bit_shift;    /* bit position of the field in that byte */
+  UINT8  dest;         /* button number of bit 0, or axis number */
+  UINT32 mask;         /* (1 << width) - 1 */
+  UINT32 sign;         /* sign bit for signed fields, 0 otherwise */
+  INT32  logical_min;
+  INT32  scale;        /* 16.16 factor from the logical range to INT16 */
+} hidraw_field_t;
+
+typedef struct {
+  UINT8          report_id;    /* 0 if the device uses no report IDs */
+  UINT16         report_size;  /* bytes, including the report ID */
+  unsigned int   n_buttons;    /* number of buttons mapped */
+  unsigned int   n_button_fields;
+  unsigned int   n_axes;
+  hidraw_field_t button_fields[HIDRAW_MAX_BUTTON_FIELDS];
+  hidraw_field_t axes[HIDRAW_MAX_AXES];
+} hidraw_plan_t;
+
+int  hidraw_compile_plan(const UINT8 *desc, unsigned int desc_size, hidraw_plan_t *plan);
+int  hidraw_probe(int fd, hidraw_plan_t *plan, char *name, unsigned int name_size);
+int  hidraw_decode(const hidraw_plan_t *plan, const UINT8 *report, unsigned int len,
+		   UINT32 *buttons, INT16 *axes);
+int  hidraw_is_device(const char *path);
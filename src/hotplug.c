@@ -0,0 +1,78 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "hotplug.h"
+
+static int  inotify_fd = -1;
+static char device_dir[128];
+static char device_base[128];
+
+int hotplug_init(const char *device_path) {
+  char path[128];
+
+  if (strlen(device_path) >= sizeof(path)) {
+    fprintf(stderr, "%s: device path too long\n", device_path);
+    return -1;
+  }
+  /* dirname() and basename() may modify their argument */
+  strncpy(path, device_path, sizeof(path) - 1);
+  path[sizeof(path) - 1] = '\0';
+  strncpy(device_dir, dirname(path), sizeof(device_dir) - 1);
+  device_dir[sizeof(device_dir) - 1] = '\0';
+  strncpy(path, device_path, sizeof(path) - 1);
+  path[sizeof(path) - 1] = '\0';
+  strncpy(device_base, basename(path), sizeof(device_base) - 1);
+  device_base[sizeof(device_base) - 1] = '\0';
+
+  if ((inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0) {
+    perror("inotify_init1");
+    return -1;
+  }
+  /* udev creates the node first and sets its permissions afterwards, so
+     the device may only become accessible on IN_ATTRIB */
+  if (inotify_add_watch(inotify_fd, device_dir,
+			IN_CREATE | IN_ATTRIB | IN_MOVED_TO) < 0) {
+    perror(device_dir);
+    close(inotify_fd);
+    inotify_fd = -1;
+    return -1;
+  }
+  return 0;
+}
+
+void hotplug_shutdown(void) {
+  if (inotify_fd >= 0) {
+    close(inotify_fd);
+    inotify_fd = -1;
+  }
+}
+
+int hotplug_get_fd(void) {
+  return inotify_fd;
+}
+
+/* Drain the pending inotify events.  Returns 1 if the watched device node
+   has been created or changed, so it is worth trying to open it. */
+int hotplug_process(void) {
+  char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  const struct inotify_event *ev;
+  ssize_t len;
+  char *p;
+  int found = 0;
+
+  while ((len = read(inotify_fd, buf, sizeof(buf))) > 0) {
+    for (p = buf; p < buf + len; p += sizeof(struct inotify_event) + ev->len) {
+      ev = (const struct inotify_event *)p;
+      if ((ev->len > 0) && (strcmp(ev->name, device_base) == 0))
+	found = 1;
+    }
+  }
+  if ((len < 0) && (errno != EAGAIN))
+    perror("inotify read");
+
+  return found;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+/* Watches the directory of the input device node with inotify, so that a
+   device which has been unplugged can be reattached as soon as its node
+   reappears. */
+
+int  hotplug_init(const char *device_path);
+void hotplug_shutdown(void);
+int  hotplug_get_fd(void);
+int  hotplug_process(void);
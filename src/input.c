@@ -0,0 +1,212 @@
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "hidraw.h"
+#include "input.h"
+
+input_channels_t input_channels;
+
+static input_source_t sources[INPUT_MAX_SOURCES];
+static unsigned int   n_sources;
+
+static const input_ops_t *const builtin_types[] = {
+  &joydev_source,
+  &hidraw_source,
+  &evdev_source,
+  &pipe_source,
+#if defined(CONFIG_APP_GPIO)
+  &gpio_source,
+#endif
+};
+
+static const input_ops_t *find_type(const char *type) {
+  unsigned int i;
+
+  for (i = 0; i < sizeof(builtin_types) / sizeof(builtin_types[0]); i++)
+    if (strcmp(builtin_types[i]->type, type) == 0)
+      return builtin_types[i];
+  return NULL;
+}
+
+static const input_ops_t *load_plugin(const char *path, void **dl) {
+  const input_ops_t *ops;
+
+  if ((*dl = dlopen(path, RTLD_NOW | RTLD_LOCAL)) == NULL) {
+    fprintf(stderr, "%s\n", dlerror());
+    return NULL;
+  }
+  if ((ops = dlsym(*dl, "input_plugin")) == NULL) {
+    fprintf(stderr, "%s: no input_plugin\n", path);
+  } else if ((ops->open == NULL) || (ops->close == NULL) ||
+	     ((ops->read_size > 0) && (ops->decode == NULL)) ||
+	     ((ops->read_size == 0) && (ops->drain == NULL))) {
+    /* input_open(), input_drain() and input_close() would call NULL */
+    fprintf(stderr, "%s: input_plugin lacks open, close, decode or drain\n", path);
+    ops = NULL;
+  } else if (ops->read_size > INPUT_READ_MAX) {
+    /* it would overrun the read buffers */
+    fprintf(stderr, "%s: read_size %u exceeds %d\n", path, ops->read_size, INPUT_READ_MAX);
+    ops = NULL;
+  }
+  if (ops == NULL) {
+    dlclose(*dl);
+    *dl = NULL;
+  }
+  return ops;
+}
+
+static input_source_t *add_source(const input_ops_t *ops, const char *arg, void *dl) {
+  input_source_t *src;
+
+  if (n_sources == INPUT_MAX_SOURCES) {
+    fprintf(stderr, "More than %d input sources\n", INPUT_MAX_SOURCES);
+    if (dl != NULL)
+      dlclose(dl);
+    return NULL;
+  }
+  src = &sources[n_sources++];
+  memset(src, 0, sizeof(*src));
+  src->ops = ops;
+  src->fd = -1;
+  src->dl = dl;
+  strncpy(src->arg, arg, sizeof(src->arg) - 1);
+  return src;
+}
+
+/* Add a source given as TYPE[:ARG][@DIGITAL_BASE[:ANALOGUE_BASE]], e.g.
+   "evdev:/dev/input/event3" or "/usr/lib/pedals.so:/dev/ttyS1@8".  The
+   bases are the first channels the inputs of the source are mapped to.
+   Returns NULL if the spec is invalid. */
+input_source_t *input_add(const char *spec) {
+  char type[128], *arg, *at, *end;
+  unsigned long digital_base = 0, analogue_base = 0;
+  const input_ops_t *ops;
+  input_source_t *src;
+  void *dl = NULL;
+
+  strncpy(type, spec, sizeof(type) - 1);
+  type[sizeof(type) - 1] = '\0';
+
+  if ((at = strrchr(type, '@')) != NULL) {
+    *at++ = '\0';
+    digital_base = strtoul(at, &end, 0);
+    if (*end == ':')
+      analogue_base = strtoul(end + 1, &end, 0);
+    if ((end == at) || (*end != '\0') ||
+	(digital_base >= INPUT_DIGITAL) || (analogue_base >= INPUT_ANALOGUE)) {
+      fprintf(stderr, "%s: invalid channel base\n", spec);
+      return NULL;
+    }
+  }
+
+  if ((arg = strchr(type, ':')) != NULL)
+    *arg++ = '\0';
+  else
+    arg = type + strlen(type);
+
+  if (strchr(type, '/') != NULL)
+    ops = load_plugin(type, &dl);
+  else if ((ops = find_type(type)) == NULL)
+    fprintf(stderr, "%s: unknown input type \"%s\"\n", spec, type);
+  if (ops == NULL)
+    return NULL;
+
+  if ((src = add_source(ops, arg, dl)) != NULL) {
+    src->digital_base = digital_base;
+    src->analogue_base = analogue_base;
+  }
+  return src;
+}
+
+/* Add a device of the type its node name suggests: hidrawN, eventN or an
+   evdev link like by-id/...-event-joystick, joydev otherwise */
+input_source_t *input_add_device(const char *path) {
+  const char *base = strrchr(path, '/');
+
+  base = base ? base + 1 : path;
+  if (hidraw_is_device(path))
+    return add_source(&hidraw_source, path, NULL);
+  if (strstr(base, "event") != NULL)
+    return add_source(&evdev_source, path, NULL);
+  return add_source(&joydev_source, path, NULL);
+}
+
+unsigned int input_count(void) {
+  return n_sources;
+}
+
+input_source_t *input_get(unsigned int i) {
+  return (i < n_sources) ? &sources[i] : NULL;
+}
+
+/* Open a source, with its fd non-blocking unless it is read through
+   io_uring.  Sources that drain their fd themselves always are. */
+int input_open(input_source_t *src, int nonblock) {
+  int flags;
+
+  src->caps = 0;
+  src->n_digital = src->n_analogue = 0;
+  src->name[0] = '\0';
+  if (src->ops->open(src) < 0) {
+    src->fd = -1;
+    return -1;
+  }
+  if (nonblock || (src->ops->read_size == 0)) {
+    flags = fcntl(src->fd, F_GETFL, 0);
+    fcntl(src->fd, F_SETFL, flags | O_NONBLOCK);
+  }
+  if (src->name[0] == '\0')
+    strncpy(src->name, "Unknown", sizeof(src->name) - 1);
+  return 0;
+}
+
+void input_close(input_source_t *src) {
+  if (src->fd < 0)
+    return;
+  src->ops->close(src);
+  src->fd = -1;
+  src->read_posted = 0;
+}
+
+/* Release all inputs of a source: buttons up, axes centered */
+void input_clear(const input_source_t *src) {
+  unsigned int i;
+
+  for (i = 0; i < src->n_digital; i++)
+    input_set_digital(src, i, 0, 0);
+  for (i = 0; i < src->n_analogue; i++)
+    input_set_analogue(src, i, 0, 0);
+}
+
+/* Read and apply everything queued on the fd of a source.  Returns 0 once
+   the fd would block, -1 with errno set if the source is gone. */
+int input_drain(input_source_t *src, UINT64 read_ns) {
+  static UINT8 buf[INPUT_READ_MAX + INPUT_READ_PAD];
+  ssize_t len;
+
+  if (src->ops->drain != NULL)
+    return src->ops->drain(src, read_ns);
+
+  while ((len = read(src->fd, buf, src->ops->read_size)) > 0)
+    src->ops->decode(src, buf, len, read_ns);
+  if ((len < 0) && (errno == EAGAIN))
+    return 0;
+  if (len == 0)
+    errno = ENODEV;
+  return -1;
+}
+
+void input_remove_all(void) {
+  unsigned int i;
+
+  for (i = 0; i < n_sources; i++) {
+    input_close(&sources[i]);
+    if (sources[i].dl != NULL)
+      dlclose(sources[i].dl);
+  }
+  n_sources = 0;
+}
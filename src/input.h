@@ -0,0 +1,157 @@
+#pragma once
+
+#include <sys/select.h>
+#include <sys/types.h>
+#include <oplk/oplk.h>
+#include "app.h"
+#include "trace.h"
+
+/* Input sources.  A source reads one device (a joystick, a set of GPIO
+   lines, a FIFO, whatever a plugin opens) and writes what it reads into
+   the channel table: the digital inputs of 0x6000 and the analogue inputs,
+   each with the time of its latest change.  app_init() links the process
+   image for the channels, processSync() copies the table into it.
+
+   All sources are opened and drained by the input loop, the single writer
+   of the table.  It applies each read under lock_state(), under which
+   processSync() copies the table, so a sync sees a read whole or not at
+   all.
+
+   Built-in types are "joydev", "hidraw", "evdev", "pipe" and, on kernels
+   with the GPIO character device v2, "gpio".  A type with
+   a '/' in it is a plugin: a shared object loaded with dlopen() that
+   exports the ops of its source as
+
+     const input_ops_t input_plugin;
+
+   Plugins include this header and write the channels through the inline
+   functions below, the program exports input_channels to them. */
+
+#define INPUT_DIGITAL       16          /* bits of 0x6000/01.. */
+#define INPUT_ANALOGUE      APP_AXES    /* raw 16 bit, linked as in axisplan.h */
+#define INPUT_MAX_SOURCES   8
+#define INPUT_READ_PAD      8           /* slack after the data for 64 bit loads */
+#define INPUT_READ_MAX      (512 - INPUT_READ_PAD)  /* bytes per read(), an io_uring buffer */
+
+/* capabilities of an open source */
+#define INPUT_CAP_DIGITAL   0x01
+#define INPUT_CAP_ANALOGUE  0x02
+#define INPUT_CAP_TIMESTAMP 0x04        /* the device stamps its events */
+
+/* event types of the event_apply probe, as joydev's */
+#define INPUT_EVENT_DIGITAL   0x01
+#define INPUT_EVENT_ANALOGUE  0x02
+#define INPUT_EVENT_INIT      0x80      /* initial state, not a change */
+
+typedef struct {
+  volatile UINT8  digital[INPUT_DIGITAL / 8];
+  volatile INT16  analogue[INPUT_ANALOGUE];
+  volatile UINT64 analogue_ns[INPUT_ANALOGUE];  /* CLOCK_MONOTONIC of the latest change */
+  volatile UINT64 digital_ns;                   /* of any digital input */
+  volatile UINT64 analogue_last_ns;             /* of any analogue input */
+  volatile UINT32 events;                       /* changes applied */
+} input_channels_t;
+
+extern input_channels_t input_channels;
+
+typedef struct input_source input_source_t;
+
+typedef struct {
+  const char   *type;
+  /* bytes read() at a time, up to INPUT_READ_MAX, plugins asking for more
+     are refused.  0 if the source reads its fd itself in drain(), it is
+     then never read through io_uring. */
+  unsigned int  read_size;
+  /* Open src->arg: set fd, caps, name, n_digital, n_analogue and apply
+     the initial state.  Returns 0, or -1 with errno set. */
+  int  (*open)(input_source_t *src);
+  /* Apply the data of one read() completed at read_ns.  buf is readable
+     INPUT_READ_PAD bytes past len.  Required unless read_size is 0. */
+  void (*decode)(input_source_t *src, const UINT8 *buf, size_t len, UINT64 read_ns);
+  /* Read and apply everything queued on the fd, required if read_size is
+     0.  Returns 0 if the fd would block, -1 with errno set if the device
+     is gone. */
+  int  (*drain)(input_source_t *src, UINT64 read_ns);
+  void (*close)(input_source_t *src);
+} input_ops_t;
+
+struct input_source {
+  const input_ops_t *ops;
+  char          arg[128];               /* device path or plugin argument */
+  int           fd;                     /* -1 while detached */
+  unsigned int  caps;                   /* INPUT_CAP_* */
+  char          name[128];
+  unsigned int  n_digital, n_analogue;
+  unsigned int  digital_base;           /* channel of digital input 0 */
+  unsigned int  analogue_base;          /* channel of analogue input 0 */
+  UINT16        fault;                  /* error history code while faulty */
+  int           read_posted;            /* a read is on the io_uring */
+  void         *priv;                   /* of the source type */
+  void         *dl;                     /* plugin handle */
+};
+
+/* Set digital input n of a source, changed at t_ns.  A t_ns of 0 sets its
+   initial state, which is no change. */
+static inline void input_set_digital(const input_source_t *src, unsigned int n,
+				     int value, UINT64 t_ns) {
+  unsigned int ch = src->digital_base + n;
+  UINT8 bit, old;
+
+  if (ch >= INPUT_DIGITAL)
+    return;
+  bit = 1 << (ch % 8);
+  old = input_channels.digital[ch / 8];
+  if ((t_ns != 0) && (!(old & bit) == !value))
+    return;
+  input_channels.digital[ch / 8] = value ? (old | bit) : (old & ~bit);
+  TRACE_PROBE3(event_apply, INPUT_EVENT_DIGITAL | (t_ns ? 0 : INPUT_EVENT_INIT), ch, !!value);
+  if (t_ns != 0) {
+    input_channels.digital_ns = t_ns;
+    input_channels.events++;
+  }
+}
+
+/* Set the first n digital inputs of a source from the bits of a word */
+static inline void input_set_digital_bits(const input_source_t *src, UINT32 bits,
+					  unsigned int n, UINT64 t_ns) {
+  unsigned int i;
+
+  for (i = 0; i < n; i++)
+    input_set_digital(src, i, (bits >> i) & 1, t_ns);
+}
+
+/* Set analogue input n of a source, changed at t_ns or initial state */
+static inline void input_set_analogue(const input_source_t *src, unsigned int n,
+				      INT16 value, UINT64 t_ns) {
+  unsigned int ch = src->analogue_base + n;
+
+  if (ch >= INPUT_ANALOGUE)
+    return;
+  if ((t_ns != 0) && (input_channels.analogue[ch] == value))
+    return;
+  input_channels.analogue[ch] = value;
+  TRACE_PROBE3(event_apply, INPUT_EVENT_ANALOGUE | (t_ns ? 0 : INPUT_EVENT_INIT), ch, value);
+  if (t_ns != 0) {
+    input_channels.analogue_ns[ch] = t_ns;
+    input_channels.analogue_last_ns = t_ns;
+    input_channels.events++;
+  }
+}
+
+input_source_t *input_add(const char *spec);
+input_source_t *input_add_device(const char *path);
+unsigned int    input_count(void);
+input_source_t *input_get(unsigned int i);
+int  input_open(input_source_t *src, int nonblock);
+void input_close(input_source_t *src);
+void input_clear(const input_source_t *src);
+int  input_drain(input_source_t *src, UINT64 read_ns);
+void input_remove_all(void);
+
+extern const input_ops_t joydev_source;
+extern const input_ops_t hidraw_source;
+extern const input_ops_t evdev_source;
+extern const input_ops_t pipe_source;
+#if defined(CONFIG_APP_GPIO)
+extern const input_ops_t gpio_source;
+#endif
@@ -0,0 +1,85 @@
+#include <fcntl.h>
+#include <linux/joystick.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include "input.h"
+
+/* joydev source, /dev/input/jsN.  Button n is digital input n, axis n
+   analogue input n.  The driver reports the initial state as events
+   flagged JS_EVENT_INIT after the open. */
+
+typedef struct {
+  UINT32 clock_offset;          /* monotonic ms - joydev event ms */
+  int    clock_synced;
+} joydev_t;
+
+static int joydev_open(input_source_t *src) {
+  unsigned char axes = 0, buttons = 0;
+  joydev_t *js;
+
+  if ((js = calloc(1, sizeof(*js))) == NULL)
+    return -1;
+  if ((src->fd = open(src->arg, O_RDONLY | O_CLOEXEC)) < 0) {
+    free(js);
+    return -1;
+  }
+  src->priv = js;
+  if (ioctl(src->fd, JSIOCGNAME(sizeof(src->name)), src->name) < 0)
+    src->name[0] = '\0';
+  ioctl(src->fd, JSIOCGAXES, &axes);
+  ioctl(src->fd, JSIOCGBUTTONS, &buttons);
+  src->n_analogue = axes;
+  src->n_digital = buttons;
+  src->caps = (buttons ? INPUT_CAP_DIGITAL : 0) | (axes ? INPUT_CAP_ANALOGUE : 0);
+  return 0;
+}
+
+/* joydev stamps its events in milliseconds of an unrelated clock.  The
+   offset to CLOCK_MONOTONIC is the smallest difference seen between the
+   time an event was read and its stamp; events read later than that have
+   been queued for the excess. */
+static UINT64 joydev_event_ns(joydev_t *js, UINT32 js_time, UINT64 read_ns) {
+  UINT32 read_ms = read_ns / 1000000;
+  INT32 queued_ms = (INT32)(read_ms - js_time - js->clock_offset);
+
+  if (!js->clock_synced || (queued_ms < 0)) {
+    js->clock_offset = read_ms - js_time;
+    js->clock_synced = 1;
+    return read_ns;
+  }
+  return read_ns - (UINT64)queued_ms * 1000000;
+}
+
+/* a read returns as many events as were queued */
+static void joydev_decode(input_source_t *src, const UINT8 *buf, size_t len, UINT64 read_ns) {
+  const struct js_event *e = (const struct js_event *)buf;
+  size_t n = len / sizeof(*e);
+  UINT64 t;
+
+  for (; n > 0; n--, e++) {
+    TRACE_PROBE4(event_read, e->time, e->type, e->number, e->value);
+    t = joydev_event_ns(src->priv, e->time, read_ns);
+    if (e->type & JS_EVENT_INIT)
+      t = 0;
+    if (e->type & JS_EVENT_BUTTON)
+      input_set_digital(src, e->number, e->value, t);
+    else if (e->type & JS_EVENT_AXIS)
+      input_set_analogue(src, e->number, e->value, t);
+  }
+}
+
+static void joydev_close(input_source_t *src) {
+  close(src->fd);
+  free(src->priv);
+  src->priv = NULL;
+}
+
+const input_ops_t joydev_source = {
+  .type      = "joydev",
+  .read_size = INPUT_READ_MAX / sizeof(struct js_event) * sizeof(struct js_event),
+  .open      = joydev_open,
+  .decode    = joydev_decode,
+  .close     = joydev_close,
+};
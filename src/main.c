@@ -1,23 +1,39 @@
 #include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/select.h>
 #include <oplk/debugstr.h>
 #include <oplk/oplk.h>
 
 #include "app.h"
+#include "capture.h"
+#include "ctlsock.h"
+#include "errhist.h"
 #include "event.h"
 #include "obdcreate.h"
+#if defined(CONFIG_APP_STORE_RESTORE)
+#include "obdstore.h"
+#endif
 #include "netselect.h"
 #include "system.h"
 #include "options.h"
 #include "screen.h"
+#include "hotplug.h"
+#include "syncmodel.h"
+#include "timeline.h"
 
 
 #define CYCLE_LEN           50000
 #define IP_ADDR             0xc0a86401          // 192.168.100.1
 #define DEFAULT_GATEWAY     0xC0A864FE          // 192.168.100.C_ADR_RT1_DEF_NODE_ID
 #define SUBNET_MASK         0xFFFFFF00          // 255.255.255.0
+#define GSOFF_TIMEOUT_MS    1000                // max. time to wait for kNmtGsOff
+#define SYNC_STOP_TIMEOUT_MS 200                // max. time to wait for the sync thread
+#define RESTART_MAX_RETRIES 5                   // restarts after GsOff before giving up
+#define RESTART_DELAY_MS    500                 // before the 2nd restart, doubled on each
+#define RESTART_STABLE_MS   10000               // up this long, the restarts count from 0
 
 static const UINT8  aMacAddr_l[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 static BOOL         fGsOff_l;
@@ -27,45 +43,78 @@ static tOplkError initPowerlink(UINT32 cycleLen_p,
                                 const char* devName_p,
                                 const UINT8* macAddr_p,
                                 UINT32 nodeId_p);
+static tOplkError restartPowerlink(void);
 static void       loopMain(void);
 static void       shutdownPowerlink(void);
 
 int main(int argc, char* argv[])
 {
     tOplkError  ret = kErrorOk;
+    unsigned int i;
+
+    timeline_init();
 
     if (getOptions(argc, argv, &opts) < 0)
         return 0;
 
+    // the joystick is the first input source, then those given with -i
+    if ((opts.joyDevName[0] != '\0') && (app_add_input_device(opts.joyDevName) < 0))
+        return 0;
+    for (i = 0; i < opts.nInputSpecs; i++)
+    {
+        if (app_add_input(opts.inputSpecs[i]) < 0)
+            return 0;
+    }
+
+    timeline_set_export_file(opts.timelineFileName);
+    syncmodel_init(opts.syncModel, processSync);
+
     if (system_init() != 0)
     {
         fprintf(stderr, "Error initializing system!");
         return 0;
     }
+    timeline_mark("system_init");
 
     initEvents(&fGsOff_l);
 
+    // open and probe the input sources while the stack comes up
+    app_start_input_setup();
+
     printf("----------------------------------------------------\n");
     printf("openPOWERLINK console CN DEMO application\n");
     printf("Using openPOWERLINK stack: %s\n", oplk_getVersionString());
     printf("Stack configuration:0x%08X\n", oplk_getStackConfiguration());
+    printf("Sync model: %s\n", syncmodel_name(opts.syncModel));
     printf("----------------------------------------------------\n");
 
     ret = initPowerlink(CYCLE_LEN,
                         opts.devName,
                         aMacAddr_l,
                         opts.nodeId);
+    timeline_mark("initPowerlink");
+
+    app_wait_input_setup();
+    timeline_mark("app_setup_inputs");
+
     if (ret != kErrorOk)
         goto Exit;
 
-    app_init();
+    app_init(syncmodel_is_concurrent(), opts.axisTypes, &opts.mix);
+    errhist_init();
+    if ((opts.captureFileName[0] != '\0') &&
+        (capture_open(opts.captureFileName, opts.captureRecords, sizeof(joystick_state_t)) < 0))
+        fprintf(stderr, "Process image capture disabled\n");
+    if (opts.presOffsetUs >= 0)
+        app_set_prediction(opts.presOffsetUs);
+    timeline_mark("app_init");
 
     screen_init();
+    timeline_mark("screen_init");
 
     loopMain();
 
 Exit:
-    app_shutdown();
     screen_shutdown();
     shutdownPowerlink();
     system_exit();
@@ -125,7 +174,7 @@ static tOplkError initPowerlink(UINT32 cycleLen_p,
     initParam.preqActPayloadLimit     = 36;                     // required for initialization (+28 bytes)
     initParam.presActPayloadLimit     = 36;                     // required for initialization of Pres frame (+28 bytes)
     initParam.asndMaxLatency          = 150000;                 // const; only required for IdentRes
-    initParam.multiplCylceCnt         = 0;                      // required for error detection
+    initParam.multiplCylceCnt         = opts.multiplCycleCnt;   // required for error detection
     initParam.asyncMtu                = 1500;                   // required to set up max frame size
     initParam.prescaler               = 2;                      // required for sync
     initParam.lossOfFrameTolerance    = 500000;
@@ -141,17 +190,13 @@ static tOplkError initPowerlink(UINT32 cycleLen_p,
     initParam.subnetMask              = SUBNET_MASK;
     initParam.defaultGateway          = DEFAULT_GATEWAY;
     sprintf((char*)initParam.sHostname, "%02x-%08x", initParam.nodeId, initParam.vendorId);
-    initParam.syncNodeId              = C_ADR_SYNC_ON_SOA;
-    initParam.fSyncOnPrcNode          = FALSE;
+    initParam.syncNodeId              = opts.syncNodeId;
+    initParam.fSyncOnPrcNode          = opts.fSyncOnPrcNode;
 
     // set callback functions
     initParam.pfnCbEvent = processEvents;
 
-#if defined(CONFIG_KERNELSTACK_DIRECTLINK)
-    initParam.pfnCbSync = processSync;
-#else
-    initParam.pfnCbSync = NULL;
-#endif
+    initParam.pfnCbSync = syncmodel_get_stack_cb();
 
     // Initialize object dictionary
     ret = obdcreate_initObd(&initParam.obdInitParam);
@@ -163,6 +208,14 @@ static tOplkError initPowerlink(UINT32 cycleLen_p,
                 ret);
         return ret;
     }
+    timeline_mark("obdcreate_initObd");
+
+#if defined(CONFIG_APP_STORE_RESTORE)
+    // Map the stored configuration, it is applied on the NMT resets
+    if (obdstore_init(opts.storeFileName, &initParam.obdInitParam) < 0)
+        fprintf(stderr, "obdstore_init() failed, using default parameters\n");
+    timeline_mark("obdstore_init");
+#endif
 
     // initialize POWERLINK stack
     ret = oplk_initialize();
@@ -174,6 +227,7 @@ static tOplkError initPowerlink(UINT32 cycleLen_p,
                 ret);
         return ret;
     }
+    timeline_mark("oplk_initialize");
 
     ret = oplk_create(&initParam);
     if (ret != kErrorOk)
@@ -184,14 +238,106 @@ static tOplkError initPowerlink(UINT32 cycleLen_p,
                 ret);
         return ret;
     }
+    timeline_mark("oplk_create");
 
     return kErrorOk;
 }
 
+//------------------------------------------------------------------------------
+/**
+\brief  Warm restart of the openPOWERLINK stack
+
+The function brings the NMT state machine down to GsOff and restarts it with a
+software reset. The stack instance, the object dictionary, the process image
+and its linkage as well as the opened input devices are kept, so the node
+re-enters PreOp1 without going through initPowerlink() and app_init() again.
+
+\return The function returns a tOplkError error code.
+*/
+//------------------------------------------------------------------------------
+static tOplkError restartPowerlink(void)
+{
+    tOplkError  ret;
+
+    printf("Restarting POWERLINK stack...\n");
+
+    if (!checkGsOffEvent())
+    {
+        clearGsOffEvent();
+        ret = oplk_execNmtCommand(kNmtEventSwitchOff);
+        if (ret != kErrorOk)
+            return ret;
+
+        if (!waitGsOffEvent(GSOFF_TIMEOUT_MS))
+        {
+            fprintf(stderr, "Stack did not reach GsOff within %d ms\n", GSOFF_TIMEOUT_MS);
+            return kErrorGeneralError;
+        }
+    }
+
+    clearGsOffEvent();
+    notifyNmtReset();
+    return oplk_execNmtCommand(kNmtEventSwReset);
+}
+
 static int max(int x, int y) {
   return x > y ? x : y;
 }
 
+static UINT64 getMonotonicMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UINT64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+//------------------------------------------------------------------------------
+/**
+\brief  Restart the stack after it went down on its own
+
+The function is called on every pass of the main loop. If the stack is in
+GsOff, e.g. after a critical error, it is restarted. A fault that persists
+would take it down again right away, so the restarts are spaced out with a
+delay that doubles on every attempt, and the application gives up after
+RESTART_MAX_RETRIES of them. Once the stack has stayed up for
+RESTART_STABLE_MS, the count starts over.
+
+\return The function returns FALSE if the application should exit.
+*/
+//------------------------------------------------------------------------------
+static BOOL recoverGsOff(void)
+{
+    static unsigned int restartCount = 0;
+    static UINT64       restartTime = 0;
+    static BOOL         fFailed = FALSE;    // the stack is still down, with the flag cleared
+    UINT64              now = getMonotonicMs();
+
+    if (!fFailed && !checkGsOffEvent())
+    {
+        if ((restartCount > 0) && (now - restartTime >= RESTART_STABLE_MS))
+            restartCount = 0;
+        return TRUE;
+    }
+
+    if ((restartCount > 0) &&
+        (now - restartTime < ((UINT64)RESTART_DELAY_MS << (restartCount - 1))))
+        return TRUE;
+
+    if (restartCount == RESTART_MAX_RETRIES)
+    {
+        fprintf(stderr, "Stack still down after %d restarts, exiting\n", RESTART_MAX_RETRIES);
+        return FALSE;
+    }
+
+    restartCount++;
+    restartTime = now;
+    fFailed = (restartPowerlink() != kErrorOk);
+    if (fFailed)
+        fprintf(stderr, "Restart %u of %d failed\n", restartCount, RESTART_MAX_RETRIES);
+    return TRUE;
+}
+
 //------------------------------------------------------------------------------
 /**
 \brief  Main loop of demo application
@@ -209,19 +355,28 @@ static void loopMain(void)
   char        cKey = 0;
   BOOL        fExit = FALSE;
   fd_set fds;
-  int app_input_fd = app_get_input_fd();
-  int screen_input_fd = screen_get_input_fd();
-  int max_fds = max(app_input_fd, screen_input_fd);
+  int app_active_fd;
+  int screen_input_fd;
+  int hotplug_fd;
+  int max_fds;
   int rval;
-    
+
+  screen_input_fd = screen_get_input_fd();
+  app_active_fd = app_get_active_fd();
+
+  /* reattach the joystick when its device node comes back */
+  if ((opts.joyDevName[0] != '\0') && (hotplug_init(opts.joyDevName) < 0))
+    fprintf(stderr, "Input hotplug disabled\n");
+  hotplug_fd = hotplug_get_fd();
+
+  if ((opts.ctlSocketName[0] != '\0') && (ctlsock_init(opts.ctlSocketName) < 0))
+    fprintf(stderr, "Control socket disabled\n");
   
-#if !defined(CONFIG_KERNELSTACK_DIRECTLINK)
-#if defined(CONFIG_USE_SYNCTHREAD)
-  system_startSyncThread(processSync);
-#endif
-#endif
+  syncmodel_start();
   
   // start processing
+  timeline_mark("NMT SwReset");
+  notifyNmtReset();
   ret = oplk_execNmtCommand(kNmtEventSwReset);
   if (ret != kErrorOk)
     return;
@@ -231,13 +386,29 @@ static void loopMain(void)
   printf("Press r to reset the node\n");
   printf("-------------------------------\n");
   
-  app_setup_inputs(opts.joyDevName);
-  
   while (!fExit) {
-    struct timeval tv = { 0, 100000 }; /* screen update interval */
+    struct timeval tv = { 0, APP_POLL_MS * 1000 }; /* screen update interval */
+    BOOL fIdle = !app_is_active();
+
+    /* without process data exchange the inputs are only drained, at the
+       screen update */
+    if (fIdle) {
+      tv.tv_sec = APP_IDLE_DRAIN_MS / 1000;
+      tv.tv_usec = (APP_IDLE_DRAIN_MS % 1000) * 1000;
+    }
+
+    max_fds = max(max(screen_input_fd, hotplug_fd), app_active_fd);
+
     FD_ZERO(&fds);
-    FD_SET(app_input_fd, &fds);
+    /* the input fds change when a device is unplugged and reattached */
+    if (!fIdle)
+      max_fds = app_fill_input_fds(&fds, max_fds);
+    if (app_active_fd >= 0)
+      FD_SET(app_active_fd, &fds);
     FD_SET(screen_input_fd, &fds);
+    if (hotplug_fd >= 0)
+      FD_SET(hotplug_fd, &fds);
+    max_fds = ctlsock_fill_fds(&fds, max_fds);
     
     if ((rval = select(max_fds + 1, &fds, 0, 0, &tv)) < 0) {
       perror("select");
@@ -247,20 +418,38 @@ static void loopMain(void)
     if (rval == 0) {
       /* timeout expired */
       screen_draw_data();
+      /* sources without hotplug monitor are retried here */
+      app_attach_inputs();
     }
+
+    app_input_heartbeat();
     
-    if (FD_ISSET(app_input_fd, &fds)) {
-      app_process_inputs();
+    if ((app_active_fd >= 0) && FD_ISSET(app_active_fd, &fds))
+      app_ack_active();
+
+    app_process_inputs(fIdle ? NULL : &fds);
+
+    if ((hotplug_fd >= 0) && FD_ISSET(hotplug_fd, &fds)) {
+      if (hotplug_process())
+	app_attach_inputs();
     }
     
+    if (ctlsock_process(&fds) & CTLSOCK_REQ_RESET) {
+      notifyNmtReset();
+      ret = oplk_execNmtCommand(kNmtEventSwReset);
+      if ((ret != kErrorOk) && (restartPowerlink() != kErrorOk))
+        fExit = TRUE;
+    }
+
     if (FD_ISSET(screen_input_fd, &fds)) {
       cKey = (char)screen_getch();
       
       switch (cKey)
 	{
 	case 'r':
+	  notifyNmtReset();
 	  ret = oplk_execNmtCommand(kNmtEventSwReset);
-	  if (ret != kErrorOk)
+	  if ((ret != kErrorOk) && (restartPowerlink() != kErrorOk))
 	    fExit = TRUE;
 	  break;
 	  
@@ -284,47 +473,60 @@ static void loopMain(void)
 	fExit = TRUE;
 	fprintf(stderr, "Kernel stack has gone! Exiting...\n");
       }
+
+    /* the stack went down on its own, e.g. on a critical error */
+    if (!fExit && !recoverGsOff())
+      fExit = TRUE;
     
-#if (!defined(CONFIG_USE_SYNCTHREAD) &&		\
-     !defined(CONFIG_KERNELSTACK_DIRECTLINK))
-    processSync();
-#endif
+    if (!syncmodel_poll())
+      fExit = TRUE;
+    errhist_publish();
   }
+
+  ctlsock_shutdown();
+  hotplug_shutdown();
 }
 
 //------------------------------------------------------------------------------
 /**
 \brief  Shutdown the demo application
 
-The function shuts down the demo application.
+The function shuts down the demo application. The sync thread is joined
+before the process image is freed, and the process image is freed before
+the stack instance is destroyed.
 */
 //------------------------------------------------------------------------------
 static void shutdownPowerlink(void)
 {
-    UINT    i;
+    BOOL    fSyncStopped = TRUE;
 
-    fGsOff_l = FALSE;
+    clearGsOffEvent();
 
-#if (!defined(CONFIG_KERNELSTACK_DIRECTLINK) && \
-     defined(CONFIG_USE_SYNCTHREAD))
-    system_stopSyncThread();
-    system_msleep(100);
-#endif
+    fSyncStopped = syncmodel_stop(SYNC_STOP_TIMEOUT_MS);
 
     // halt the NMT state machine so the processing of POWERLINK frames stops
     oplk_execNmtCommand(kNmtEventSwitchOff);
 
-    // small loop to implement timeout waiting for thread to terminate
-    for (i = 0; i < 1000; i++)
+    if (waitGsOffEvent(GSOFF_TIMEOUT_MS))
+        printf("Stack is in state off ... Shutdown\n");
+    else
+        fprintf(stderr, "Stack did not reach GsOff within %d ms ... Shutdown\n", GSOFF_TIMEOUT_MS);
+
+    // a sync thread that is still running may access the process image
+    if (fSyncStopped)
     {
-        if (fGsOff_l)
-            break;
+        capture_close();
+        app_shutdown();
     }
-
-    printf("Stack is in state off ... Shutdown\n");
+    else
+        fprintf(stderr, "Sync thread still running, keeping the process image\n");
 
     oplk_destroy();
     oplk_exit();
+
+#if defined(CONFIG_APP_STORE_RESTORE)
+    obdstore_exit();
+#endif
 }
 
 /// \}
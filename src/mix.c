@@ -0,0 +1,61 @@
+#include <stdlib.h>
+#include <string.h>
+#include "mix.h"
+
+void mix_init(mix_t *mix) {
+  memset(mix, 0, sizeof(*mix));
+}
+
+/* Add a channel given as "COEFF_X,COEFF_Y[,OFFSET]".  Returns -1 if the
+   specification is malformed or all channels are in use. */
+int mix_add_channel(mix_t *mix, const char *spec) {
+  float v[MIX_INPUTS + 1] = { 0.0f };
+  const char *s = spec;
+  char *end;
+  int i;
+
+  if (mix->n == MIX_CHANNELS)
+    return -1;
+  for (i = 0; i < MIX_INPUTS + 1; i++) {
+    v[i] = strtof(s, &end);
+    /* NaN fails both comparisons, it would pass the clamps of mix_run() */
+    if ((end == s) || !((v[i] >= -MIX_VALUE_MAX) && (v[i] <= MIX_VALUE_MAX)))
+      return -1;
+    s = end;
+    if (*s == '\0')
+      break;
+    if (*s++ != ',')
+      return -1;
+  }
+  if ((i < MIX_INPUTS - 1) || (*s != '\0'))
+    return -1;
+
+  for (i = 0; i < MIX_INPUTS; i++)
+    mix->m[i][mix->n] = v[i];
+  mix->offset[mix->n] = v[MIX_INPUTS];
+  mix->n++;
+  return 0;
+}
+
+/* Compute all MIX_CHANNELS lanes, the unused ones have zero coefficients.
+   Branch-free on local copies, so the compiler keeps the lanes in one
+   vector register and broadcasts each input. */
+void mix_run(const mix_t *mix, const INT16 in[MIX_INPUTS], INT16 out[MIX_CHANNELS]) {
+  float acc[MIX_CHANNELS], m[MIX_INPUTS][MIX_CHANNELS];
+  float x;
+  int i, j;
+
+  memcpy(acc, mix->offset, sizeof(acc));
+  memcpy(m, mix->m, sizeof(m));
+  for (i = 0; i < MIX_INPUTS; i++) {
+    x = in[i];
+    for (j = 0; j < MIX_CHANNELS; j++)
+      acc[j] += m[i][j] * x;
+  }
+  for (j = 0; j < MIX_CHANNELS; j++) {
+    acc[j] = acc[j] < -32767.0f ? -32767.0f : acc[j];
+    acc[j] = acc[j] > 32767.0f ? 32767.0f : acc[j];
+  }
+  for (j = 0; j < MIX_CHANNELS; j++)
+    out[j] = (INT16)acc[j];
+}
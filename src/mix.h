@@ -0,0 +1,29 @@
+#pragma once
+
+#include <oplk/oplk.h>
+
+/* Virtual analogue channels, each a linear mix of the stick axes plus an
+   offset, clamped to the INT16 range:
+
+     out[j] = offset[j] + sum_i m[i][j] * in[i]
+
+   e.g. differential steering from "1,1" and "1,-1", or a rotation of the
+   stick coordinates.  The matrix is stored by input column and padded to
+   MIX_CHANNELS lanes, so that the matrix-vector product is a few vector
+   multiply-adds. */
+
+#define MIX_INPUTS    2    /* axis_x, axis_y */
+#define MIX_CHANNELS  4    /* 0x6401 subindexes 0x03 to 0x06 */
+/* bound of the coefficients and offsets, which keeps the sums finite: any
+   coefficient beyond it saturates the channel anyway */
+#define MIX_VALUE_MAX 65536.0f
+
+typedef struct {
+  unsigned int n;                           /* channels in use */
+  float        m[MIX_INPUTS][MIX_CHANNELS]; /* coefficients, by input */
+  float        offset[MIX_CHANNELS];
+} mix_t;
+
+void mix_init(mix_t *mix);
+int  mix_add_channel(mix_t *mix, const char *spec);
+void mix_run(const mix_t *mix, const INT16 in[MIX_INPUTS], INT16 out[MIX_CHANNELS]);
@@ -0,0 +1,418 @@
+/* Persistent store/restore of the object dictionary (0x1010/0x1011).
+
+   All storable objects (access type kObdAccStore, the "S" in kObdAccSRW) are
+   kept in a single file which is memory mapped at startup:
+
+     tObdStoreHeader | value of storable entry 0 | value of entry 1 | ...
+
+   The values are packed back to back in OD table order.  The header carries a
+   CRC over the OD layout, so a file written by a binary with a different
+   object dictionary is ignored instead of being applied at the wrong offsets,
+   and a CRC over the data, so a torn write falls back to the default values.
+   A store writes a temporary file and renames it over the old one. */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "obdstore.h"
+
+#define OBDSTORE_MAGIC          0x53444F4F      /* "OODS" */
+#define OBDSTORE_VERSION        1
+#define OBDSTORE_MAX_ENTRIES    256
+
+#define OBDSTORE_SIGNATURE_SAVE 0x65766173      /* "save" */
+#define OBDSTORE_SIGNATURE_LOAD 0x64616F6C      /* "load" */
+
+typedef struct
+{
+    UINT32  magic;
+    UINT16  version;
+    UINT16  partMask;       /* partitions holding valid data */
+    UINT32  layoutCrc;      /* CRC over index/subindex/size of all entries */
+    UINT32  dataSize;
+    UINT32  dataCrc;
+} tObdStoreHeader;
+
+typedef struct
+{
+    void*   pCurrent;
+    UINT16  size;
+    UINT8   part;
+} tObdStoreEntry;
+
+static char                 fileName_l[128];
+static tObdStoreEntry       aEntry_l[OBDSTORE_MAX_ENTRIES];
+static UINT                 entryCount_l;
+static UINT32               dataSize_l;
+static UINT32               layoutCrc_l;
+static tObdStoreHeader*     pMap_l;             /* valid mapping or NULL */
+
+static UINT32 crc32(UINT32 crc_p, const void* pData_p, size_t size_p)
+{
+    const UINT8*    pData = (const UINT8*)pData_p;
+    int             bit;
+
+    crc_p = ~crc_p;
+    while (size_p--)
+    {
+        crc_p ^= *pData++;
+        for (bit = 0; bit < 8; bit++)
+            crc_p = (crc_p >> 1) ^ (0xEDB88320 & (0 - (crc_p & 1)));
+    }
+    return ~crc_p;
+}
+
+static UINT getTypeSize(tObdType type_p)
+{
+    switch (type_p)
+    {
+        case kObdTypeBool:
+        case kObdTypeInt8:
+        case kObdTypeUInt8:
+            return 1;
+
+        case kObdTypeInt16:
+        case kObdTypeUInt16:
+            return 2;
+
+        case kObdTypeInt24:
+        case kObdTypeUInt24:
+            return 3;
+
+        case kObdTypeInt32:
+        case kObdTypeUInt32:
+        case kObdTypeReal32:
+            return 4;
+
+        case kObdTypeInt40:
+        case kObdTypeUInt40:
+            return 5;
+
+        case kObdTypeInt48:
+        case kObdTypeUInt48:
+            return 6;
+
+        case kObdTypeInt56:
+        case kObdTypeUInt56:
+            return 7;
+
+        case kObdTypeInt64:
+        case kObdTypeUInt64:
+        case kObdTypeReal64:
+            return 8;
+
+        default:    /* strings and domains are not stored */
+            return 0;
+    }
+}
+
+static int collectPart(const tObdEntry* pEntry_p, UINT8 part_p)
+{
+    const tObdSubEntry* pSub;
+    UINT                subCount;
+    UINT                size;
+    UINT8               key[4];
+
+    for (; (pEntry_p != NULL) && (pEntry_p->index != OBD_TABLE_INDEX_END); pEntry_p++)
+    {
+        for (subCount = 0, pSub = pEntry_p->pSubIndex;
+             subCount < pEntry_p->count;
+             subCount++, pSub++)
+        {
+            if (((pSub->access & kObdAccStore) == 0) ||
+                ((pSub->access & kObdAccVar) != 0) ||
+                (pSub->pCurrent == NULL))
+                continue;
+
+            if ((size = getTypeSize(pSub->type)) == 0)
+                continue;
+
+            /* one array descriptor covers all remaining subindices */
+            if ((pSub->access & kObdAccArray) != 0)
+            {
+                size *= pEntry_p->count - subCount;
+                subCount = pEntry_p->count;
+            }
+
+            if (entryCount_l == OBDSTORE_MAX_ENTRIES)
+            {
+                fprintf(stderr, "%s() too many storable objects\n", __func__);
+                return -1;
+            }
+            aEntry_l[entryCount_l].pCurrent = pSub->pCurrent;
+            aEntry_l[entryCount_l].size = (UINT16)size;
+            aEntry_l[entryCount_l].part = part_p;
+            entryCount_l++;
+            dataSize_l += size;
+
+            key[0] = (UINT8)pEntry_p->index;
+            key[1] = (UINT8)(pEntry_p->index >> 8);
+            key[2] = (UINT8)pSub->subIndex;
+            key[3] = (UINT8)size;
+            layoutCrc_l = crc32(layoutCrc_l, key, sizeof(key));
+        }
+    }
+    return 0;
+}
+
+static void unmapFile(void)
+{
+    if (pMap_l != NULL)
+    {
+        munmap(pMap_l, sizeof(tObdStoreHeader) + dataSize_l);
+        pMap_l = NULL;
+    }
+}
+
+static void mapFile(void)
+{
+    int                 fd;
+    struct stat         st;
+    tObdStoreHeader*    pMap;
+    size_t              mapSize = sizeof(tObdStoreHeader) + dataSize_l;
+
+    if ((fd = open(fileName_l, O_RDONLY)) < 0)
+        return;
+
+    if ((fstat(fd, &st) < 0) || ((size_t)st.st_size != mapSize))
+    {
+        close(fd);
+        return;
+    }
+
+    pMap = (tObdStoreHeader*)mmap(NULL, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (pMap == MAP_FAILED)
+        return;
+
+    if ((pMap->magic != OBDSTORE_MAGIC) ||
+        (pMap->version != OBDSTORE_VERSION) ||
+        (pMap->layoutCrc != layoutCrc_l) ||
+        (pMap->dataSize != dataSize_l) ||
+        (pMap->dataCrc != crc32(0, pMap + 1, dataSize_l)))
+    {
+        fprintf(stderr, "Ignoring invalid OD store %s\n", fileName_l);
+        munmap(pMap, mapSize);
+        return;
+    }
+
+    pMap_l = pMap;
+}
+
+/* Write a new store file.  Partitions in snapshotMask_p are taken from the
+   current OD values, the rest of validMask_p is carried over from the old
+   file.  A zero validMask_p removes the file. */
+static int writeFile(UINT validMask_p, UINT snapshotMask_p)
+{
+    char                tmpName[sizeof(fileName_l) + 4];
+    int                 fd;
+    size_t              mapSize = sizeof(tObdStoreHeader) + dataSize_l;
+    tObdStoreHeader*    pMap;
+    UINT8*              pData;
+    UINT                i;
+
+    if (validMask_p == 0)
+    {
+        unmapFile();
+        if ((unlink(fileName_l) < 0) && (errno != ENOENT))
+        {
+            perror(fileName_l);
+            return -1;
+        }
+        return 0;
+    }
+
+    snprintf(tmpName, sizeof(tmpName), "%s.new", fileName_l);
+    if ((fd = open(tmpName, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0)
+    {
+        perror(tmpName);
+        return -1;
+    }
+    if (ftruncate(fd, mapSize) < 0)
+    {
+        perror(tmpName);
+        close(fd);
+        return -1;
+    }
+    pMap = (tObdStoreHeader*)mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (pMap == MAP_FAILED)
+    {
+        perror(tmpName);
+        return -1;
+    }
+
+    pData = (UINT8*)(pMap + 1);
+    if (pMap_l != NULL)
+        memcpy(pData, pMap_l + 1, dataSize_l);
+
+    for (i = 0; i < entryCount_l; i++)
+    {
+        if ((aEntry_l[i].part & snapshotMask_p) != 0)
+            memcpy(pData, aEntry_l[i].pCurrent, aEntry_l[i].size);
+        pData += aEntry_l[i].size;
+    }
+
+    pMap->magic = OBDSTORE_MAGIC;
+    pMap->version = OBDSTORE_VERSION;
+    pMap->partMask = (UINT16)validMask_p;
+    pMap->layoutCrc = layoutCrc_l;
+    pMap->dataSize = dataSize_l;
+    pMap->dataCrc = crc32(0, pMap + 1, dataSize_l);
+
+    if (msync(pMap, mapSize, MS_SYNC) < 0)
+    {
+        perror(tmpName);
+        munmap(pMap, mapSize);
+        unlink(tmpName);
+        return -1;
+    }
+    munmap(pMap, mapSize);
+
+    if (rename(tmpName, fileName_l) < 0)
+    {
+        perror(fileName_l);
+        unlink(tmpName);
+        return -1;
+    }
+
+    unmapFile();
+    mapFile();
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+\brief  Initialize the OD store
+
+The function collects the storable objects from the OD tables created by
+obdcreate_initObd() and maps and validates the store file.  It has to be
+called before oplk_create() so that a stored configuration is available
+when the stack passes through its first reset.
+
+\param[in]      pFileName_p         Path of the store file
+\param[in]      pInitParam_p        OD tables as returned by obdcreate_initObd()
+
+\return The function returns 0 on success, otherwise -1.
+*/
+//------------------------------------------------------------------------------
+int obdstore_init(const char* pFileName_p, const tObdInitParam* pInitParam_p)
+{
+    strncpy(fileName_l, pFileName_p, sizeof(fileName_l) - 1);
+    entryCount_l = 0;
+    dataSize_l = 0;
+    layoutCrc_l = 0;
+
+    if ((collectPart(pInitParam_p->pGenericPart, OBDSTORE_PART_GENERIC) < 0) ||
+        (collectPart(pInitParam_p->pManufacturerPart, OBDSTORE_PART_MANUFACTURER) < 0) ||
+        (collectPart(pInitParam_p->pDevicePart, OBDSTORE_PART_DEVICE) < 0))
+        return -1;
+
+    mapFile();
+    if (pMap_l != NULL)
+        printf("Loaded OD store %s (%u objects, %u bytes)\n",
+               fileName_l, entryCount_l, dataSize_l);
+
+    return 0;
+}
+
+void obdstore_exit(void)
+{
+    unmapFile();
+}
+
+//------------------------------------------------------------------------------
+/**
+\brief  Restore stored values into the OD
+
+The function copies the stored values of the selected partitions into the
+current values of the OD.  The stack loads the default values on every
+kNmtGsResetApplication/kNmtGsResetCommunication, so the event handler calls
+this right after those state changes.
+
+\param[in]      partMask_p          OBDSTORE_PART_* partitions to restore
+*/
+//------------------------------------------------------------------------------
+void obdstore_restore(UINT partMask_p)
+{
+    const UINT8*    pData;
+    UINT            i;
+
+    if (pMap_l == NULL)
+        return;
+
+    partMask_p &= pMap_l->partMask;
+    if (partMask_p == 0)
+        return;
+
+    pData = (const UINT8*)(pMap_l + 1);
+    for (i = 0; i < entryCount_l; i++)
+    {
+        if ((aEntry_l[i].part & partMask_p) != 0)
+            memcpy(aEntry_l[i].pCurrent, pData, aEntry_l[i].size);
+        pData += aEntry_l[i].size;
+    }
+}
+
+int obdstore_store(UINT partMask_p)
+{
+    UINT    validMask = (pMap_l != NULL) ? pMap_l->partMask : 0;
+
+    return writeFile(validMask | partMask_p, partMask_p);
+}
+
+int obdstore_clear(UINT partMask_p)
+{
+    UINT    validMask = (pMap_l != NULL) ? pMap_l->partMask : 0;
+
+    return writeFile(validMask & ~partMask_p, 0);
+}
+
+//------------------------------------------------------------------------------
+/**
+\brief  Process OD accesses to 0x1010/0x1011
+
+The function executes the store ("save") and restore defaults ("load")
+commands written to NMT_StoreParam_REC and NMT_RestoreDefParam_REC.
+
+\param[in]      pParam_p            OD access parameters from the stack
+
+\return The function returns a tOplkError error code.
+*/
+//------------------------------------------------------------------------------
+tOplkError obdstore_processObdAccess(const tObdCbParam* pParam_p)
+{
+    static const UINT   aPartMask[] = { 0,
+                                        OBDSTORE_PART_ALL,
+                                        OBDSTORE_PART_GENERIC,
+                                        OBDSTORE_PART_DEVICE,
+                                        OBDSTORE_PART_MANUFACTURER };
+    UINT32              signature;
+
+    if ((pParam_p->obdEvent != kObdEvPreWrite) ||
+        ((pParam_p->index != 0x1010) && (pParam_p->index != 0x1011)) ||
+        (pParam_p->subIndex == 0) ||
+        (pParam_p->subIndex >= (sizeof(aPartMask) / sizeof(aPartMask[0]))))
+        return kErrorOk;
+
+    memcpy(&signature, pParam_p->pArg, sizeof(signature));
+
+    if ((pParam_p->index == 0x1010) && (signature == OBDSTORE_SIGNATURE_SAVE))
+    {
+        if (obdstore_store(aPartMask[pParam_p->subIndex]) < 0)
+            return kErrorObdAccessViolation;
+    }
+    else if ((pParam_p->index == 0x1011) && (signature == OBDSTORE_SIGNATURE_LOAD))
+    {
+        if (obdstore_clear(aPartMask[pParam_p->subIndex]) < 0)
+            return kErrorObdAccessViolation;
+    }
+    else
+        return kErrorObdAccessViolation;
+
+    return kErrorOk;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <oplk/oplk.h>
+
+/* Object dictionary partitions, as selected by the subindices of
+   0x1010 NMT_StoreParam_REC and 0x1011 NMT_RestoreDefParam_REC. */
+#define OBDSTORE_PART_GENERIC       0x01    /* 0x1000 - 0x1FFF communication */
+#define OBDSTORE_PART_MANUFACTURER  0x02    /* 0x2000 - 0x5FFF manufacturer */
+#define OBDSTORE_PART_DEVICE        0x04    /* 0x6000 - 0x9FFF application */
+#define OBDSTORE_PART_ALL           (OBDSTORE_PART_GENERIC | \
+                                     OBDSTORE_PART_MANUFACTURER | \
+                                     OBDSTORE_PART_DEVICE)
+
+int        obdstore_init(const char* pFileName_p, const tObdInitParam* pInitParam_p);
+void       obdstore_exit(void);
+void       obdstore_restore(UINT partMask_p);
+int        obdstore_store(UINT partMask_p);
+int        obdstore_clear(UINT partMask_p);
+tOplkError obdstore_processObdAccess(const tObdCbParam* pParam_p);
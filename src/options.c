@@ -2,6 +2,7 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <oplk/oplk.h>
 #include "options.h"
 
 //------------------------------------------------------------------------------
@@ -25,23 +26,48 @@ int getOptions(int argc_p,
 	       tOptions* pOpts_p)
 {
     int opt;
+    int i;
 
     // Defaults:
     const char   joystick_device_name[] = "/dev/input/js0";
+    const char   store_file_name[] = "powerlink-cn-joystick.od";
     const unsigned int NODEID = 1;
 
     /* setup default parameters */
     strncpy(pOpts_p->devName, "\0", 128);
     strncpy(pOpts_p->joyDevName, joystick_device_name, 128);
+    pOpts_p->nInputSpecs = 0;
+    strncpy(pOpts_p->storeFileName, store_file_name, 128);
+    strncpy(pOpts_p->timelineFileName, "\0", 128);
+    strncpy(pOpts_p->ctlSocketName, "\0", 108);
+    strncpy(pOpts_p->captureFileName, "\0", 128);
+    pOpts_p->captureRecords = CAPTURE_RECORDS;
     pOpts_p->nodeId = NODEID;
+    pOpts_p->syncModel = SYNC_MODEL_DEFAULT;
+    pOpts_p->presOffsetUs = -1;
+    pOpts_p->syncNodeId = C_ADR_SYNC_ON_SOA;
+    pOpts_p->fSyncOnPrcNode = FALSE;
+    pOpts_p->multiplCycleCnt = 0;
+    for (i = 0; i < APP_AXES; i++)
+        pOpts_p->axisTypes[i] = AXIS_INT16;
+    mix_init(&pOpts_p->mix);
 
     /* get command line parameters */
-    while ((opt = getopt(argc_p, argv_p, "n:d:j:")) != -1)
+    while ((opt = getopt(argc_p, argv_p, "n:d:j:i:s:t:k:p:P:m:x:y:cu:a:v:")) != -1)
     {
         switch (opt)
         {
             case 'n':
                 pOpts_p->nodeId = strtoul(optarg, NULL, 10);
+#if defined(CONFIG_APP_LEAN_OD)
+                // the node ID indexes 0x1F9B, sized for the lean profile
+                if ((pOpts_p->nodeId == 0) || (pOpts_p->nodeId > CONFIG_APP_LEAN_OD_MAX_NODE_ID))
+                {
+                    fprintf(stderr, "Node ID %s is beyond the %u nodes of the lean OD\n",
+                            optarg, CONFIG_APP_LEAN_OD_MAX_NODE_ID);
+                    goto Usage;
+                }
+#endif
                 break;
 
             case 'd':
@@ -52,16 +78,161 @@ int getOptions(int argc_p,
                 strncpy(pOpts_p->joyDevName, optarg, 128);
                 break;
 
+            case 'i':
+                if (pOpts_p->nInputSpecs == INPUT_MAX_SOURCES - 1)
+                {
+                    fprintf(stderr, "More than %d input sources\n", INPUT_MAX_SOURCES - 1);
+                    goto Usage;
+                }
+                strncpy(pOpts_p->inputSpecs[pOpts_p->nInputSpecs++], optarg, 127);
+                break;
+
+            case 's':
+                strncpy(pOpts_p->storeFileName, optarg, sizeof(pOpts_p->storeFileName) - 1);
+                pOpts_p->storeFileName[sizeof(pOpts_p->storeFileName) - 1] = '\0';
+                break;
+
+            case 't':
+                strncpy(pOpts_p->timelineFileName, optarg, sizeof(pOpts_p->timelineFileName) - 1);
+                pOpts_p->timelineFileName[sizeof(pOpts_p->timelineFileName) - 1] = '\0';
+                break;
+
+            case 'k':
+                strncpy(pOpts_p->ctlSocketName, optarg, 107);
+                break;
+
+            case 'p':
+                strncpy(pOpts_p->captureFileName, optarg, 127);
+                break;
+
+            case 'P':
+                pOpts_p->captureRecords = strtoul(optarg, NULL, 10);
+                if (pOpts_p->captureRecords == 0)
+                {
+                    fprintf(stderr, "Invalid capture size \"%s\"\n", optarg);
+                    goto Usage;
+                }
+                break;
+
+            case 'm':
+                if (syncmodel_parse(optarg, &pOpts_p->syncModel) < 0)
+                {
+                    fprintf(stderr, "Unknown sync model \"%s\"\n", optarg);
+                    goto Usage;
+                }
+                break;
+
+            case 'x':
+                pOpts_p->presOffsetUs = strtoul(optarg, NULL, 10);
+                break;
+
+            case 'y':
+                if (strcmp(optarg, "soa") == 0)
+                    pOpts_p->syncNodeId = C_ADR_SYNC_ON_SOA;
+                else if (strcmp(optarg, "soc") == 0)
+                    pOpts_p->syncNodeId = C_ADR_SYNC_ON_SOC;
+                else
+                {
+                    pOpts_p->syncNodeId = strtoul(optarg, NULL, 10);
+                    if ((pOpts_p->syncNodeId == 0) || (pOpts_p->syncNodeId > C_ADR_MN_DEF_NODE_ID))
+                    {
+                        fprintf(stderr, "Invalid sync point \"%s\"\n", optarg);
+                        goto Usage;
+                    }
+                }
+                break;
+
+            case 'c':
+                pOpts_p->fSyncOnPrcNode = TRUE;
+                break;
+
+            case 'u':
+                pOpts_p->multiplCycleCnt = strtoul(optarg, NULL, 10);
+                if (pOpts_p->multiplCycleCnt > 255)
+                {
+                    fprintf(stderr, "Invalid multiplexed cycle count \"%s\"\n", optarg);
+                    goto Usage;
+                }
+                break;
+
+            case 'a':
+                if (axisplan_parse(optarg, pOpts_p->axisTypes, APP_AXES) < 0)
+                {
+                    fprintf(stderr, "Invalid axis types \"%s\"\n", optarg);
+                    goto Usage;
+                }
+                break;
+
+            case 'v':
+                if (mix_add_channel(&pOpts_p->mix, optarg) < 0)
+                {
+                    fprintf(stderr, "Invalid virtual channel \"%s\"\n", optarg);
+                    goto Usage;
+                }
+                break;
+
             default: /* '?' */
-                printf("Usage: %s [-n NODE_ID] [-d DEV_NAME] [-j JS_DEV_NAME] [-p]\n", argv_p[0]);
+            Usage:
+                printf("Usage: %s [-n NODE_ID] [-d DEV_NAME] [-j JS_DEV_NAME] [-i INPUT]... [-s STORE_FILE] [-t TIMELINE_FILE] [-k CTL_SOCKET] [-p CAPTURE_FILE] [-P CAPTURE_RECORDS] [-m SYNC_MODEL] [-x PRES_OFFSET_US] [-y SYNC_POINT] [-c] [-u MUX_CYCLES] [-a AXIS_TYPES] [-v MIX]...\n", argv_p[0]);
                 printf(" -d DEV_NAME:    Ethernet device name to use e.g. eth1. If option\n");
                 printf("                 is skipped the program prompts for the interface.\n");
-                printf(" -j JS_DEV_NAME: Joystick device name to use.\n");
+                printf(" -j JS_DEV_NAME: Joystick device name to use, a joydev device\n");
+                printf("                 (/dev/input/jsN), an evdev device (/dev/input/eventN)\n");
+                printf("                 or a raw HID device (/dev/hidrawN), \"\" for none.\n");
 		printf("                 Defaults to \"%s\"\n", joystick_device_name);
+                printf(" -i INPUT:       Add an input source TYPE[:ARG][@BUTTON[:AXIS]]\n");
+                printf("                 of type \"joydev\", \"evdev\", \"hidraw\", \"pipe\",\n");
+                printf("                 \"gpio\" (src/gpio.c) or a plugin given by its path,\n");
+                printf("                 see src/input.h. Its inputs are mapped from button\n");
+                printf("                 BUTTON of 0x6000 and axis AXIS on, e.g.\n");
+                printf("                 -i gpio:gpiochip0:4-7@8. Up to %d\n",
+                       INPUT_MAX_SOURCES - 1);
+                printf(" -s STORE_FILE:  File for the parameters stored via 0x1010.\n");
+                printf("                 Defaults to \"%s\". Builds configured with\n", store_file_name);
+                printf("                 --enable-store-restore only.\n");
+                printf(" -t TIMELINE_FILE: Export the startup timeline as CSV.\n");
+                printf(" -k CTL_SOCKET:  Serve the control and subscription protocol of\n");
+                printf("                 src/ctlsock.h on the Unix socket CTL_SOCKET.\n");
+                printf(" -p CAPTURE_FILE: Record the process image of every sync cycle,\n");
+                printf("                 see src/capture.h and powerlink-cn-joystick-capdecode.\n");
+                printf(" -P CAPTURE_RECORDS: Cycles kept in CAPTURE_FILE, the oldest are\n");
+                printf("                 overwritten. Defaults to %d\n", CAPTURE_RECORDS);
+                printf(" -m SYNC_MODEL:  Where the process image is exchanged: \"main\" loop,\n");
+                printf("                 sync \"thread\" or \"direct\" link callback from the\n");
+                printf("                 kernel stack. \"direct\" needs a stack library built\n");
+                printf("                 for direct link, the program exits if no sync callback\n");
+                printf("                 arrives in ReadyToOperate. Defaults to \"%s\"\n",
+                       syncmodel_name(SYNC_MODEL_DEFAULT));
+                printf(" -x PRES_OFFSET_US: Extrapolate the axes to the next SoC plus\n");
+                printf("                 PRES_OFFSET_US, the time until the PRes is sent.\n");
+                printf("                 With PRes chaining the PResTimeFirst configured by\n");
+                printf("                 the MN replaces PRES_OFFSET_US.\n");
+                printf(" -y SYNC_POINT:  Frame that triggers the sync callback: \"soa\",\n");
+                printf("                 \"soc\" or the node ID whose PRes is used (240: PResMN).\n");
+                printf("                 Defaults to \"soa\"\n");
+                printf(" -c:             The sync node given with -y NODE_ID is PRes chained.\n");
+                printf(" -u MUX_CYCLES:  Multiplexed cycle count until the MN configures\n");
+                printf("                 0x1F98/07, 0 for a continuous CN. Defaults to 0\n");
+                printf(" -a AXIS_TYPES:  Data type of each axis, comma separated: \"8\"\n");
+                printf("                 (0x6400), \"16\" (0x6401), \"32\" (0x6402) or \"f\"\n");
+                printf("                 REAL32 (0x6403). Defaults to \"16,16\"\n");
+                printf(" -v MIX:         Add a virtual channel COEFF_X,COEFF_Y[,OFFSET]\n");
+                printf("                 mixed from the axes, linked to 0x6401/03 and up.\n");
+                printf("                 Up to %d, e.g. -v 1,1 -v 1,-1 for differential steering.\n",
+                       MIX_CHANNELS);
+                printf("                 Values are finite, within +-%.0f\n", MIX_VALUE_MAX);
 
                 return -1;
         }
     }
+
+    // chaining is a property of a node, not of the SoA or SoC
+    if (pOpts_p->fSyncOnPrcNode &&
+        ((pOpts_p->syncNodeId == C_ADR_SYNC_ON_SOA) || (pOpts_p->syncNodeId == C_ADR_SYNC_ON_SOC)))
+    {
+        fprintf(stderr, "-c needs the node ID of the sync node given with -y\n");
+        return -1;
+    }
     return 0;
 }
 
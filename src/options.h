@@ -1,10 +1,29 @@
 #pragma once
 
+#include "app.h"
+#include "capture.h"
+#include "input.h"
+#include "syncmodel.h"
+
 typedef struct
 {
     unsigned int    nodeId;
     char            devName[128];
     char            joyDevName[128];
+    char            inputSpecs[INPUT_MAX_SOURCES - 1][128];
+    unsigned int    nInputSpecs;
+    char            storeFileName[128];
+    char            timelineFileName[128];
+    char            ctlSocketName[108];
+    char            captureFileName[128];
+    unsigned int    captureRecords;
+    sync_model_t    syncModel;
+    int             presOffsetUs;       // < 0: no axis extrapolation
+    unsigned int    syncNodeId;         // C_ADR_SYNC_ON_SOA, C_ADR_SYNC_ON_SOC or a node ID
+    int             fSyncOnPrcNode;
+    unsigned int    multiplCycleCnt;
+    axis_type_t     axisTypes[APP_AXES];
+    mix_t           mix;
 } tOptions;
 
 int getOptions(int argc_p,
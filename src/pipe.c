@@ -0,0 +1,103 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "input.h"
+
+/* Text source, a FIFO or a character device such as a serial line.  Each
+   line sets one input of the source:
+
+     d N VALUE    digital input N, 0 or 1
+     a N VALUE    analogue input N, -32767..32767
+
+   e.g. echo "d 3 1" > /run/plkjoy-panel.  A FIFO is opened read-write, so
+   it stays open while no writer is attached.  Lines are stamped when
+   read.  Regular files are refused: their end would detach the source,
+   which is then attached again and replays the file forever. */
+
+#define PIPE_LINE_MAX  64
+
+typedef struct {
+  char         line[PIPE_LINE_MAX];
+  unsigned int len;
+  int          overlong;          /* skip to the end of the line */
+} pipe_src_t;
+
+static int pipe_open(input_source_t *src) {
+  struct stat st;
+  pipe_src_t *p;
+
+  if (stat(src->arg, &st) < 0)
+    return -1;
+  if (!S_ISFIFO(st.st_mode) && !S_ISCHR(st.st_mode)) {
+    fprintf(stderr, "%s: not a FIFO or character device\n", src->arg);
+    errno = EINVAL;
+    return -1;
+  }
+  if ((p = calloc(1, sizeof(*p))) == NULL)
+    return -1;
+  if (S_ISFIFO(st.st_mode))
+    src->fd = open(src->arg, O_RDWR | O_CLOEXEC);
+  else
+    src->fd = open(src->arg, O_RDONLY | O_CLOEXEC);
+  if (src->fd < 0) {
+    free(p);
+    return -1;
+  }
+  src->priv = p;
+  snprintf(src->name, sizeof(src->name), "%s", src->arg);
+  src->n_digital = INPUT_DIGITAL;
+  src->n_analogue = INPUT_ANALOGUE;
+  src->caps = INPUT_CAP_DIGITAL | INPUT_CAP_ANALOGUE;
+  return 0;
+}
+
+static void apply_line(input_source_t *src, const char *line, UINT64 read_ns) {
+  unsigned int n;
+  char kind;
+  int value;
+
+  if (sscanf(line, " %c %u %d", &kind, &n, &value) != 3)
+    return;
+  if ((kind == 'd') && (n < src->n_digital))
+    input_set_digital(src, n, value != 0, read_ns);
+  else if ((kind == 'a') && (n < src->n_analogue))
+    input_set_analogue(src, n, (value < -32767) ? -32767 : (value > 32767) ? 32767 : value,
+		       read_ns);
+}
+
+static void pipe_decode(input_source_t *src, const UINT8 *buf, size_t len, UINT64 read_ns) {
+  pipe_src_t *p = src->priv;
+  size_t i;
+
+  for (i = 0; i < len; i++) {
+    if (buf[i] == '\n') {
+      p->line[p->len] = '\0';
+      if (!p->overlong)
+	apply_line(src, p->line, read_ns);
+      p->len = 0;
+      p->overlong = 0;
+    } else if (p->len < PIPE_LINE_MAX - 1) {
+      p->line[p->len++] = buf[i];
+    } else {
+      p->overlong = 1;
+    }
+  }
+}
+
+static void pipe_close(input_source_t *src) {
+  close(src->fd);
+  free(src->priv);
+  src->priv = NULL;
+}
+
+const input_ops_t pipe_source = {
+  .type      = "pipe",
+  .read_size = INPUT_READ_MAX,
+  .open      = pipe_open,
+  .decode    = pipe_decode,
+  .close     = pipe_close,
+};
@@ -0,0 +1,54 @@
+#include <string.h>
+#include "predict.h"
+
+void predict_init(predict_t *p, float alpha, float beta) {
+  memset(p, 0, sizeof(*p));
+  p->alpha = alpha;
+  p->beta = beta;
+}
+
+/* Feed the latest measurement of every axis and return the estimates at
+   t_target.  z[i] was measured at t_meas[i]; the input devices only report
+   changes, so an axis without a new event since the last call is taken to
+   still be at z[i] at t_now.  That lets the velocity decay when the stick
+   stops instead of extrapolating the last move forever. */
+void predict_run(predict_t *p, const INT16 z[PREDICT_AXES], const UINT64 t_meas[PREDICT_AXES],
+		 UINT64 t_now, UINT64 t_target, INT16 out[PREDICT_AXES]) {
+  float dt[PREDICT_AXES], lead[PREDICT_AXES], a[PREDICT_AXES], b[PREDICT_AXES];
+  float zf[PREDICT_AXES], x[PREDICT_AXES], v[PREDICT_AXES], o[PREDICT_AXES];
+  UINT64 t;
+  int i;
+
+  /* 64 bit time stamps to per-axis gains and intervals in seconds */
+  for (i = 0; i < PREDICT_AXES; i++) {
+    t = (t_meas[i] > p->t[i]) ? t_meas[i] : t_now;
+    dt[i] = (p->t[i] != 0 && t > p->t[i]) ? (float)(t - p->t[i]) * 1e-9f : 0.0f;
+    lead[i] = (t_target > t) ? (float)(t_target - t) * 1e-9f : 0.0f;
+    /* the first measurement initializes the position, later ones only
+       correct it; nothing to learn if no time has passed */
+    a[i] = (p->t[i] == 0) ? 1.0f : (dt[i] > 0.0f) ? p->alpha : 0.0f;
+    b[i] = (dt[i] > 0.0f) ? p->beta / dt[i] : 0.0f;
+    zf[i] = z[i];
+    p->t[i] = t;
+  }
+
+  /* branch-free on local copies, so the compiler can keep all lanes in
+     one vector register */
+  memcpy(x, p->x, sizeof(x));
+  memcpy(v, p->v, sizeof(v));
+  for (i = 0; i < PREDICT_AXES; i++) {
+    float xp = x[i] + v[i] * dt[i];
+    float r = zf[i] - xp;
+
+    x[i] = xp + a[i] * r;
+    v[i] = v[i] + b[i] * r;
+    o[i] = x[i] + v[i] * lead[i];
+    o[i] = o[i] < -32767.0f ? -32767.0f : o[i];
+    o[i] = o[i] > 32767.0f ? 32767.0f : o[i];
+  }
+  memcpy(p->x, x, sizeof(x));
+  memcpy(p->v, v, sizeof(v));
+
+  for (i = 0; i < PREDICT_AXES; i++)
+    out[i] = (INT16)o[i];
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <oplk/oplk.h>
+
+/* Alpha-beta filter that extrapolates the axes to the instant at which
+   they are transmitted.  The state is kept as structure of arrays padded
+   to PREDICT_AXES lanes, so that the per-axis math vectorizes. */
+
+#define PREDICT_AXES   4    /* two axes used, padded to a SIMD width */
+#define PREDICT_ALPHA  0.8f
+#define PREDICT_BETA   0.3f
+
+typedef struct {
+  float  alpha;
+  float  beta;
+  float  x[PREDICT_AXES];   /* filtered position */
+  float  v[PREDICT_AXES];   /* filtered velocity, units per second */
+  UINT64 t[PREDICT_AXES];   /* time of the last measurement, ns */
+} predict_t;
+
+void predict_init(predict_t *p, float alpha, float beta);
+void predict_run(predict_t *p, const INT16 z[PREDICT_AXES], const UINT64 t_meas[PREDICT_AXES],
+		 UINT64 t_now, UINT64 t_target, INT16 out[PREDICT_AXES]);
@@ -0,0 +1,137 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "syncmodel.h"
+#include "system.h"
+
+static const char *const model_names[] = {
+  [SYNC_MODEL_MAIN_LOOP]   = "main",
+  [SYNC_MODEL_THREAD]      = "thread",
+  [SYNC_MODEL_DIRECT_LINK] = "direct",
+};
+
+static sync_model_t sync_model = SYNC_MODEL_DEFAULT;
+static tSyncCb      sync_cb;
+
+/* Process data is only exchanged in ReadyToOperate and Operational.  In
+   the other NMT states the sync thread sleeps until it is woken by
+   syncmodel_set_active() or syncmodel_stop(), the other models skip the
+   sync callback. */
+static pthread_mutex_t active_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  active_cond = PTHREAD_COND_INITIALIZER;
+static volatile int    sync_active;
+static int             sync_stopping;
+
+/* Only a direct link stack library calls the sync callback of the stack,
+   any other would never run processSync().  Checked by syncmodel_poll(). */
+static UINT32          direct_calls;
+static UINT32          direct_calls_active;  /* at the last activation */
+static UINT64          active_since_ms;
+
+static UINT64 monotonic_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (UINT64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Returns 0 and sets *model if name is one of "main", "thread" or
+   "direct", -1 otherwise. */
+int syncmodel_parse(const char *name, sync_model_t *model) {
+  unsigned int i;
+
+  for (i = 0; i < sizeof(model_names) / sizeof(model_names[0]); i++) {
+    if (strcmp(name, model_names[i]) == 0) {
+      *model = (sync_model_t)i;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+const char *syncmodel_name(sync_model_t model) {
+  return model_names[model];
+}
+
+void syncmodel_init(sync_model_t model, tSyncCb pfnSync) {
+  sync_model = model;
+  sync_cb = pfnSync;
+}
+
+int syncmodel_is_concurrent(void) {
+  return sync_model != SYNC_MODEL_MAIN_LOOP;
+}
+
+static tOplkError direct_sync(void) {
+  __atomic_fetch_add(&direct_calls, 1, __ATOMIC_RELAXED);
+  return sync_active ? sync_cb() : kErrorOk;
+}
+
+static tOplkError thread_sync(void) {
+  pthread_mutex_lock(&active_mutex);
+  while (!sync_active && !sync_stopping)
+    pthread_cond_wait(&active_cond, &active_mutex);
+  pthread_mutex_unlock(&active_mutex);
+  return sync_active ? sync_cb() : kErrorOk;
+}
+
+/* The sync callback to pass to the stack in tOplkApiInitParam.pfnCbSync */
+tSyncCb syncmodel_get_stack_cb(void) {
+  return (sync_model == SYNC_MODEL_DIRECT_LINK) ? direct_sync : NULL;
+}
+
+void syncmodel_start(void) {
+  sync_stopping = 0;
+  if (sync_model == SYNC_MODEL_THREAD)
+    system_startSyncThread(thread_sync);
+}
+
+/* Called on every NMT state change, active in the states that exchange
+   process data */
+void syncmodel_set_active(int active) {
+  pthread_mutex_lock(&active_mutex);
+  if (active && !sync_active) {
+    direct_calls_active = __atomic_load_n(&direct_calls, __ATOMIC_RELAXED);
+    active_since_ms = monotonic_ms();
+  }
+  sync_active = active;
+  pthread_cond_broadcast(&active_cond);
+  pthread_mutex_unlock(&active_mutex);
+}
+
+/* Called once per pass of the main loop.  Returns FALSE if the direct
+   link model got no sync callback within SYNC_DIRECT_TIMEOUT_MS of
+   entering ReadyToOperate: the stack library is no direct link one. */
+BOOL syncmodel_poll(void) {
+  BOOL ok = TRUE;
+
+  if ((sync_model == SYNC_MODEL_MAIN_LOOP) && sync_active)
+    sync_cb();
+  if (sync_model != SYNC_MODEL_DIRECT_LINK)
+    return TRUE;
+
+  pthread_mutex_lock(&active_mutex);
+  if (sync_active &&
+      (__atomic_load_n(&direct_calls, __ATOMIC_RELAXED) == direct_calls_active) &&
+      (monotonic_ms() - active_since_ms > SYNC_DIRECT_TIMEOUT_MS))
+    ok = FALSE;
+  pthread_mutex_unlock(&active_mutex);
+  if (!ok)
+    fprintf(stderr, "No sync callback from the stack within %d ms of ReadyToOperate, "
+	    "sync model \"direct\" needs a direct link stack library\n", SYNC_DIRECT_TIMEOUT_MS);
+  return ok;
+}
+
+/* Returns TRUE once the sync callback can no longer run from the sync
+   thread.  In the direct link model the stack stops calling it when it is
+   switched off. */
+BOOL syncmodel_stop(unsigned int timeout_ms) {
+  pthread_mutex_lock(&active_mutex);
+  sync_stopping = 1;
+  pthread_cond_broadcast(&active_cond);
+  pthread_mutex_unlock(&active_mutex);
+  if (sync_model == SYNC_MODEL_THREAD)
+    return system_stopSyncThread(timeout_ms);
+  return TRUE;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <oplk/oplk.h>
+
+/* Execution model of the synchronous process image exchange, selected on
+   the command line:
+
+   - main:   processSync() is called at the end of every pass of loopMain()
+   - thread: a dedicated sync thread calls processSync() in a loop
+   - direct: the stack calls processSync() itself (kernel stack direct link).
+             Only a direct link stack library does, syncmodel_poll() fails
+             if no call arrives in ReadyToOperate.
+
+   With "thread" and "direct" processSync() runs concurrently with the input
+   handling, so the process image has to be locked.
+
+   In all models processSync() only runs while the NMT state exchanges
+   process data, see syncmodel_set_active(). */
+
+typedef enum {
+  SYNC_MODEL_MAIN_LOOP,
+  SYNC_MODEL_THREAD,
+  SYNC_MODEL_DIRECT_LINK,
+} sync_model_t;
+
+#define SYNC_MODEL_DEFAULT  SYNC_MODEL_THREAD
+
+/* "direct" fails if no sync callback arrives within this time of
+   entering ReadyToOperate, a few cycles of any usual cycle length */
+#define SYNC_DIRECT_TIMEOUT_MS  1000
+
+int         syncmodel_parse(const char *name, sync_model_t *model);
+const char *syncmodel_name(sync_model_t model);
+void        syncmodel_init(sync_model_t model, tSyncCb pfnSync);
+int         syncmodel_is_concurrent(void);
+tSyncCb     syncmodel_get_stack_cb(void);
+void        syncmodel_start(void);
+void        syncmodel_set_active(int active);
+BOOL        syncmodel_poll(void);
+BOOL        syncmodel_stop(unsigned int timeout_ms);
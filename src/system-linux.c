@@ -48,8 +48,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <errno.h>
 #include <pthread.h>
 #include <signal.h>
+#include <stdatomic.h>
+#include <string.h>
 #include <sys/time.h>
+#include <time.h>
 #include "system.h"
+#include "trace.h"
 #include <sched.h>
 
 //============================================================================//
@@ -61,6 +65,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //------------------------------------------------------------------------------
 #define SET_CPU_AFFINITY
 #define MAIN_THREAD_PRIORITY        20
+#define SYNC_THREAD_WAKEUP_SIGNAL   SIGUSR1
 
 //------------------------------------------------------------------------------
 // module global vars
@@ -81,13 +86,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //------------------------------------------------------------------------------
 // local types
 //------------------------------------------------------------------------------
-#if defined(CONFIG_USE_SYNCTHREAD)
 typedef struct
 {
     tSyncCb                 pfnSyncCb;
-    BOOL                    fTerminate;
+    atomic_bool             fTerminate;
+    BOOL                    fRunning;
 } tSyncThreadInstance;
-#endif
 
 typedef struct
 {
@@ -101,10 +105,8 @@ typedef struct
 //------------------------------------------------------------------------------
 static BOOL                 fTermSignalReceived_l = FALSE;
 
-#if defined(CONFIG_USE_SYNCTHREAD)
 static pthread_t            syncThreadId_l;
 static tSyncThreadInstance  syncThreadInstance_l;
-#endif
 
 static tFwmThreadInstance   fwmThreadInstance_l;
 
@@ -112,10 +114,9 @@ static tFwmThreadInstance   fwmThreadInstance_l;
 // local function prototypes
 //------------------------------------------------------------------------------
 static void handleTermSignal(int signum);
+static void handleWakeupSignal(int signum);
 
-#if defined(CONFIG_USE_SYNCTHREAD)
 static void* powerlinkSyncThread(void* arg);
-#endif
 
 static void* firmwareManagerThread(void* arg);
 
@@ -255,7 +256,6 @@ void system_msleep(unsigned int milliSeconds_p)
     }
 }
 
-#if defined(CONFIG_USE_SYNCTHREAD)
 //------------------------------------------------------------------------------
 /**
 \brief  Start synchronous data thread
@@ -269,10 +269,18 @@ The function starts the thread used for synchronous data handling.
 //------------------------------------------------------------------------------
 void system_startSyncThread(tSyncCb pfnSync_p)
 {
-    int ret;
+    int                 ret;
+    struct sigaction    wakeupAction;
+
+    // The wakeup signal interrupts a blocking oplk_waitSyncEvent() on stop.
+    // No SA_RESTART, so the wait returns instead of being resumed.
+    wakeupAction.sa_handler = handleWakeupSignal;
+    sigemptyset(&wakeupAction.sa_mask);
+    wakeupAction.sa_flags = 0;
+    sigaction(SYNC_THREAD_WAKEUP_SIGNAL, &wakeupAction, NULL);
 
     syncThreadInstance_l.pfnSyncCb = pfnSync_p;
-    syncThreadInstance_l.fTerminate = FALSE;
+    atomic_store(&syncThreadInstance_l.fTerminate, FALSE);
 
     // create sync thread
     ret = pthread_create(&syncThreadId_l,
@@ -284,6 +292,7 @@ void system_startSyncThread(tSyncCb pfnSync_p)
         fprintf(stderr, "pthread_create() failed with \"%d\"\n", ret);
         return;
     }
+    syncThreadInstance_l.fRunning = TRUE;
 
 #if (defined(__GLIBC__) && (__GLIBC__ >= 2) && (__GLIBC_MINOR__ >= 12))
     pthread_setname_np(syncThreadId_l, "oplkdemo-sync");
@@ -294,16 +303,51 @@ void system_startSyncThread(tSyncCb pfnSync_p)
 /**
 \brief  Stop synchronous data thread
 
-The function stops the thread used for synchronous data handling.
+The function stops the thread used for synchronous data handling. It sets
+the stop flag, wakes the thread out of a pending oplk_waitSyncEvent() and
+joins it. When the function returns TRUE the sync callback is no longer
+running, so the process image can safely be freed.
+
+\param[in]      timeoutMs_p         Maximum time to wait for the thread to exit
+
+\return The function returns TRUE if the thread has terminated, otherwise FALSE.
 
 \ingroup module_app_common
 */
 //------------------------------------------------------------------------------
-void system_stopSyncThread(void)
+BOOL system_stopSyncThread(unsigned int timeoutMs_p)
 {
-    syncThreadInstance_l.fTerminate = TRUE;
+    struct timespec deadline;
+    int             ret;
+
+    if (!syncThreadInstance_l.fRunning)
+        return TRUE;
+
+    atomic_store(&syncThreadInstance_l.fTerminate, TRUE);
+    pthread_kill(syncThreadId_l, SYNC_THREAD_WAKEUP_SIGNAL);
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeoutMs_p / 1000;
+    deadline.tv_nsec += (long)(timeoutMs_p % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    ret = pthread_timedjoin_np(syncThreadId_l, NULL, &deadline);
+    if (ret != 0)
+    {
+        fprintf(stderr, "%s() sync thread did not terminate within %u ms (%s)\n",
+                __func__,
+                timeoutMs_p,
+                strerror(ret));
+        return FALSE;
+    }
+
+    syncThreadInstance_l.fRunning = FALSE;
+    return TRUE;
 }
-#endif
 
 //------------------------------------------------------------------------------
 /**
@@ -389,6 +433,7 @@ static void handleTermSignal(int signum)
         case SIGINT:    // Signals with termination semantics
         case SIGTERM:   // trigger a flag change
         case SIGQUIT:
+            TRACE_PROBE1(term_signal, signum);
             fTermSignalReceived_l = TRUE;
             break;
 
@@ -397,7 +442,22 @@ static void handleTermSignal(int signum)
     }
 }
 
-#if defined(CONFIG_USE_SYNCTHREAD)
+//------------------------------------------------------------------------------
+/**
+\brief  Handle the sync thread wakeup signal
+
+The handler does nothing. Delivering the signal is enough to interrupt a
+blocking system call in the sync thread.
+
+\param[in]      signum              Received signal.
+
+*/
+//------------------------------------------------------------------------------
+static void handleWakeupSignal(int signum)
+{
+    UNUSED_PARAMETER(signum);
+}
+
 //------------------------------------------------------------------------------
 /**
 \brief  Synchronous application thread
@@ -412,15 +472,16 @@ static void* powerlinkSyncThread(void* arg)
     tSyncThreadInstance*    pSyncThreadInstance = (tSyncThreadInstance*)arg;
 
     printf("Synchronous data thread is starting...\n");
-    while (!pSyncThreadInstance->fTerminate)
+    TRACE_PROBE0(sync_thread_start);
+    while (!atomic_load(&pSyncThreadInstance->fTerminate))
     {
         pSyncThreadInstance->pfnSyncCb();
     }
+    TRACE_PROBE0(sync_thread_stop);
     printf("Synchronous data thread is terminating...\n");
 
     return NULL;
 }
-#endif
 
 //------------------------------------------------------------------------------
 /**
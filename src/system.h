@@ -67,10 +67,8 @@ void system_exit(void);
 BOOL system_getTermSignalState();
 void system_msleep(unsigned int milliSeconds_p);
 
-#if defined(CONFIG_USE_SYNCTHREAD)
 void system_startSyncThread(tSyncCb pfnSync_p);
-void system_stopSyncThread(void);
-#endif
+BOOL system_stopSyncThread(unsigned int timeoutMs_p);
 
 void system_startFirmwareManagerThread(tFirmwareManagerThreadCb pfnFwmThreadCb_p,
                                        unsigned int intervalSec_p);
@@ -0,0 +1,97 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "timeline.h"
+
+#define TIMELINE_MAX_MARKS 64
+
+typedef struct {
+  const char      *phase;
+  struct timespec  ts;
+} timeline_mark_t;
+
+static pthread_mutex_t  timeline_mutex = PTHREAD_MUTEX_INITIALIZER;
+static timeline_mark_t  marks[TIMELINE_MAX_MARKS];
+static unsigned int     mark_count;
+static struct timespec  start_ts;
+static char             export_name[128];
+static int              reported;
+
+static long elapsed_us(const struct timespec *from, const struct timespec *to) {
+  return (long)(to->tv_sec - from->tv_sec) * 1000000L +
+    (to->tv_nsec - from->tv_nsec) / 1000L;
+}
+
+/* Start the timeline, called first thing in main(). */
+void timeline_init(void) {
+  clock_gettime(CLOCK_MONOTONIC, &start_ts);
+  mark_count = 0;
+  reported = 0;
+}
+
+/* If file_name is not empty, the timeline is also written there as CSV
+   when timeline_report() runs. */
+void timeline_set_export_file(const char *file_name) {
+  strncpy(export_name, file_name, sizeof(export_name) - 1);
+}
+
+/* Record the end of a phase.  The phase string must stay valid, marks are
+   taken from the main thread as well as from the stack's event thread. */
+void timeline_mark(const char *phase) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  pthread_mutex_lock(&timeline_mutex);
+  if (mark_count < TIMELINE_MAX_MARKS) {
+    marks[mark_count].phase = phase;
+    marks[mark_count].ts = ts;
+    mark_count++;
+  }
+  pthread_mutex_unlock(&timeline_mutex);
+}
+
+void timeline_print(FILE *fp) {
+  const struct timespec *prev = &start_ts;
+  unsigned int i;
+
+  pthread_mutex_lock(&timeline_mutex);
+  fprintf(fp, "Startup timeline:\n");
+  fprintf(fp, "  %10s %10s  %s\n", "t [us]", "delta [us]", "phase");
+  for (i = 0; i < mark_count; i++) {
+    fprintf(fp, "  %10ld %10ld  %s\n",
+	    elapsed_us(&start_ts, &marks[i].ts),
+	    elapsed_us(prev, &marks[i].ts),
+	    marks[i].phase);
+    prev = &marks[i].ts;
+  }
+  pthread_mutex_unlock(&timeline_mutex);
+}
+
+static void timeline_export(void) {
+  FILE *fp;
+  unsigned int i;
+
+  if ((fp = fopen(export_name, "w")) == NULL) {
+    perror(export_name);
+    return;
+  }
+  pthread_mutex_lock(&timeline_mutex);
+  fprintf(fp, "phase,t_us\n");
+  for (i = 0; i < mark_count; i++)
+    fprintf(fp, "%s,%ld\n", marks[i].phase, elapsed_us(&start_ts, &marks[i].ts));
+  pthread_mutex_unlock(&timeline_mutex);
+  fclose(fp);
+}
+
+/* Print and export the timeline, once, when the node first reaches
+   Operational. */
+void timeline_report(void) {
+  if (reported)
+    return;
+  reported = 1;
+
+  timeline_print(stdout);
+  if (export_name[0] != '\0')
+    timeline_export();
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdio.h>
+
+/* Startup timeline: one monotonic timestamp per startup phase, from
+   timeline_init() at process start until the node is Operational. */
+
+void timeline_init(void);
+void timeline_set_export_file(const char *file_name);
+void timeline_mark(const char *phase);
+void timeline_print(FILE *fp);
+void timeline_report(void);
@@ -0,0 +1,192 @@
+/* Decoder of the process image capture written with -p, see src/capture.h.
+
+   Prints the records of the capture oldest first, one line per sync cycle,
+   or exports them as CSV with -c.  The process image is split into the
+   objects listed in the capture header, each decoded with the data type it
+   has in the object dictionary of the build (src/obdcreate.c).  -x adds
+   the raw bytes of the process image as hex.
+
+   The file may be read while it is written: records overwritten during
+   the decoding are skipped. */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "capfile.h"
+#include "obdcreate.h"
+
+static const struct {
+  UINT16 state;
+  const char *name;
+} nmt_states[] = {
+  { kNmtCsNotActive, "NotActive" },
+  { kNmtCsPreOperational1, "PreOp1" },
+  { kNmtCsBasicEthernet, "BasicEthernet" },
+  { kNmtCsStopped, "Stopped" },
+  { kNmtCsPreOperational2, "PreOp2" },
+  { kNmtCsReadyToOperate, "ReadyToOp" },
+  { kNmtCsOperational, "Operational" },
+};
+
+static tObdInitParam od;
+
+static const char *nmt_name(UINT16 state) {
+  unsigned int i;
+
+  for (i = 0; i < sizeof(nmt_states) / sizeof(nmt_states[0]); i++)
+    if (nmt_states[i].state == state)
+      return nmt_states[i].name;
+  return NULL;
+}
+
+static const tObdSubEntry *find_in_part(const tObdEntry *part, UINT index, UINT subindex) {
+  const tObdEntry *entry;
+  const tObdSubEntry *sub;
+  unsigned int i;
+
+  for (entry = part; (entry != NULL) && (entry->index != OBD_TABLE_INDEX_END); entry++) {
+    if (entry->index != index)
+      continue;
+    for (i = 0, sub = entry->pSubIndex; i < entry->count; i++, sub++) {
+      /* one table entry holds all elements of an array */
+      if ((sub->subIndex == subindex) ||
+          ((sub->access & kObdAccArray) && (subindex > sub->subIndex)))
+        return sub;
+    }
+  }
+  return NULL;
+}
+
+/* Data type of an object in the OD, kObdTypeDomain if it is not there */
+static tObdType object_type(const capture_object_t *obj) {
+  const tObdSubEntry *sub;
+
+  if (((sub = find_in_part((const tObdEntry *)od.pGenericPart, obj->index, obj->subindex)) == NULL) &&
+      ((sub = find_in_part((const tObdEntry *)od.pManufacturerPart, obj->index, obj->subindex)) == NULL) &&
+      ((sub = find_in_part((const tObdEntry *)od.pDevicePart, obj->index, obj->subindex)) == NULL)) {
+    fprintf(stderr, "0x%04X/%02X is not in the OD, printed as hex\n", obj->index, obj->subindex);
+    return kObdTypeDomain;
+  }
+  return sub->type;
+}
+
+static void print_value(FILE *fp, const UINT8 *p, size_t size, tObdType type) {
+  UINT64 u = 0;
+  INT64 s;
+  float f;
+  double d;
+  size_t i;
+
+  /* the process image is in host byte order, little endian on all targets */
+  for (i = 0; (i < size) && (i < sizeof(u)); i++)
+    u |= (UINT64)p[i] << (8 * i);
+  switch (type) {
+  case kObdTypeBool:
+  case kObdTypeUInt8:
+  case kObdTypeUInt16:
+  case kObdTypeUInt24:
+  case kObdTypeUInt32:
+  case kObdTypeUInt40:
+  case kObdTypeUInt48:
+  case kObdTypeUInt56:
+  case kObdTypeUInt64:
+    fprintf(fp, "%" PRIu64, u);
+    break;
+  case kObdTypeInt8:
+  case kObdTypeInt16:
+  case kObdTypeInt24:
+  case kObdTypeInt32:
+  case kObdTypeInt40:
+  case kObdTypeInt48:
+  case kObdTypeInt56:
+  case kObdTypeInt64:
+    s = (size < sizeof(s)) ? (INT64)(u << (64 - 8 * size)) >> (64 - 8 * size) : (INT64)u;
+    fprintf(fp, "%" PRId64, s);
+    break;
+  case kObdTypeReal32:
+    memcpy(&f, p, sizeof(f));
+    fprintf(fp, "%g", f);
+    break;
+  case kObdTypeReal64:
+    memcpy(&d, p, sizeof(d));
+    fprintf(fp, "%g", d);
+    break;
+  default:
+    for (i = 0; i < size; i++)
+      fprintf(fp, "%02x", p[i]);
+    break;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const capture_header_t *header;
+  const capture_record_t *r;
+  tObdType types[CAPTURE_MAX_OBJECTS];
+  const char *name;
+  capfile_t cap;
+  unsigned int i, k;
+  int opt, csv = 0, hex = 0, ret;
+  char sep;
+
+  while ((opt = getopt(argc, argv, "cx")) != -1) {
+    switch (opt) {
+    case 'c':
+      csv = 1;
+      break;
+    case 'x':
+      hex = 1;
+      break;
+    default:
+      goto usage;
+    }
+  }
+  if (optind + 1 != argc)
+    goto usage;
+
+  if ((ret = capfile_open(&cap, argv[optind])) != 0) {
+    if (ret > 0)
+      fprintf(stderr, "%s: not a capture\n", argv[optind]);
+    return 1;
+  }
+  header = cap.header;
+
+  obdcreate_initObd(&od);
+  for (k = 0; k < header->n_objects; k++)
+    types[k] = object_type(&header->objects[k]);
+
+  sep = csv ? ',' : ' ';
+  printf("cycle%ctime_ns%cnet_time%cnmt_state", sep, sep, sep);
+  for (k = 0; k < header->n_objects; k++)
+    printf("%c0x%04X/%02X", sep, header->objects[k].index, header->objects[k].subindex);
+  if (hex)
+    printf("%cpi", sep);
+  printf("\n");
+
+  while ((r = capfile_next(&cap)) != NULL) {
+    printf("%" PRIu32 "%c%" PRIu64 "%c%" PRIu32 ".%09" PRIu32 "%c",
+           r->cycle, sep, r->time_ns, sep, r->net_sec, r->net_nsec, sep);
+    if (!csv && ((name = nmt_name(r->nmt_state)) != NULL))
+      printf("%s", name);
+    else
+      printf("0x%04X", r->nmt_state);
+    for (k = 0; k < header->n_objects; k++) {
+      putchar(sep);
+      print_value(stdout, r->pi + header->objects[k].offset, header->objects[k].size, types[k]);
+    }
+    if (hex) {
+      putchar(sep);
+      for (i = 0; i < header->pi_size; i++)
+        printf("%02x", r->pi[i]);
+    }
+    printf("\n");
+  }
+  capfile_close(&cap);
+  return 0;
+
+usage:
+  fprintf(stderr, "Usage: %s [-c] [-x] CAPTURE_FILE\n", argv[0]);
+  fprintf(stderr, " -c: export as CSV\n");
+  fprintf(stderr, " -x: add the raw process image as hex\n");
+  return 2;
+}
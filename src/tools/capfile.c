@@ -0,0 +1,106 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "capfile.h"
+
+/* Map the capture and check its header.  Returns 1 without a message if
+   the file is no capture, -1 on other errors. */
+int capfile_open(capfile_t *cap, const char *path) {
+  const capture_header_t *header;
+  struct stat st;
+  UINT64 written;
+  unsigned int k;
+
+  memset(cap, 0, sizeof(*cap));
+  if (((cap->fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) || (fstat(cap->fd, &st) < 0)) {
+    perror(path);
+    capfile_close(cap);
+    return -1;
+  }
+  if ((size_t)st.st_size < CAPTURE_HEADER_SIZE) {
+    capfile_close(cap);
+    return 1;
+  }
+  cap->map_size = st.st_size;
+  if ((cap->map = mmap(NULL, cap->map_size, PROT_READ, MAP_SHARED, cap->fd, 0)) == MAP_FAILED) {
+    perror("mmap");
+    cap->map = NULL;
+    capfile_close(cap);
+    return -1;
+  }
+  header = cap->header = cap->map;
+  if (memcmp(header->magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0) {
+    capfile_close(cap);
+    return 1;
+  }
+  if ((header->version != CAPTURE_VERSION) ||
+      (header->records == 0) ||
+      (header->n_objects > CAPTURE_MAX_OBJECTS) ||
+      (header->record_size < sizeof(capture_record_t) + header->pi_size) ||
+      ((UINT64)header->header_size + (UINT64)header->records * header->record_size >
+       (UINT64)st.st_size)) {
+    fprintf(stderr, "%s: not a capture of version %d\n", path, CAPTURE_VERSION);
+    capfile_close(cap);
+    return -1;
+  }
+  for (k = 0; k < header->n_objects; k++) {
+    if (header->objects[k].offset + header->objects[k].size > header->pi_size) {
+      fprintf(stderr, "%s: object 0x%04X/%02X beyond the process image\n", path,
+              header->objects[k].index, header->objects[k].subindex);
+      capfile_close(cap);
+      return -1;
+    }
+  }
+
+  if ((cap->record = malloc(header->record_size)) == NULL) {
+    perror("malloc");
+    capfile_close(cap);
+    return -1;
+  }
+  written = __atomic_load_n(&header->written, __ATOMIC_ACQUIRE);
+  cap->next = (written > header->records) ? written - header->records : 0;
+  cap->end = written;
+  return 0;
+}
+
+/* The next record, NULL after the last one written when the capture was
+   opened.  Records overwritten in the meantime are skipped. */
+const capture_record_t *capfile_next(capfile_t *cap) {
+  const capture_header_t *header = cap->header;
+  UINT64 n;
+
+  while (cap->next < cap->end) {
+    n = cap->next++;
+    memcpy(cap->record, (const UINT8 *)cap->map + header->header_size +
+           (n % header->records) * header->record_size, header->record_size);
+    /* the writer has wrapped around onto this record: overwritten, or
+       being overwritten unless the capture is closed */
+    if (__atomic_load_n(&header->written, __ATOMIC_ACQUIRE) < n + header->records + header->closed)
+      return cap->record;
+  }
+  return NULL;
+}
+
+/* Position of an object in header->objects, -1 if it is not captured */
+int capfile_find(const capfile_t *cap, UINT16 index, UINT8 subindex) {
+  unsigned int k;
+
+  for (k = 0; k < cap->header->n_objects; k++)
+    if ((cap->header->objects[k].index == index) && (cap->header->objects[k].subindex == subindex))
+      return k;
+  return -1;
+}
+
+void capfile_close(capfile_t *cap) {
+  free(cap->record);
+  if (cap->map != NULL)
+    munmap(cap->map, cap->map_size);
+  if (cap->fd >= 0)
+    close(cap->fd);
+  memset(cap, 0, sizeof(*cap));
+  cap->fd = -1;
+}
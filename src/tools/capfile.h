@@ -0,0 +1,20 @@
+#pragma once
+
+#include "capture.h"
+
+/* Reading a process image capture (src/capture.h), record by record in
+   the order they were written.  The file may still be written to. */
+
+typedef struct {
+  int fd;
+  void *map;
+  size_t map_size;
+  const capture_header_t *header;
+  capture_record_t *record;     /* copy of the current record */
+  UINT64 next, end;
+} capfile_t;
+
+int  capfile_open(capfile_t *cap, const char *path);
+const capture_record_t *capfile_next(capfile_t *cap);
+int  capfile_find(const capfile_t *cap, UINT16 index, UINT8 subindex);
+void capfile_close(capfile_t *cap);
@@ -0,0 +1,450 @@
+/* Latency and jitter analysis of recorded runs, in a single pass over the
+   files and in constant memory, so that captures and traces of hours can
+   be analyzed as they come.
+
+   A run is any number of files of two kinds:
+
+   - process image captures written with -p (src/capture.h)
+   - input traces recorded with tools/trace-input.bt, one USDT probe hit
+     per line: "<CLOCK_MONOTONIC ns> <probe> [args...]"
+
+   From a capture it measures the age of the latest axis and button change
+   at the sync that took it (0x2001 against the SoC NetTime), the sync
+   period and its jitter, and counts button changes that were hidden by a
+   later change within the same cycle.  From a trace it measures the time
+   from each input event to the exchange of the process image, from the
+   sync to the exchange, the sync period and its jitter, and counts button
+   edges that never reached an exchange.
+
+   Each distribution goes into a log-linear histogram with 0.8% resolution.
+   The jitter is the deviation of the sync period from -T PERIOD_US, or
+   else from the moving average of the period.  Periods longer than 1.5
+   times that are counted as missed syncs instead.  With -b the same
+   analysis runs on a baseline and the exit status is 1 if a percentile of
+   the run exceeds that of the baseline by more than -t PERCENT (default
+   10). */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "capfile.h"
+
+#define SUB_BITS       7
+#define SUB            (1 << SUB_BITS)
+#define N_BUCKETS      (SUB + (64 - SUB_BITS) * (SUB / 2))
+#define MAX_PENDING    4096       /* input events between two exchanges */
+#define MAX_FILES      16
+#define MIN_REGRESSION 1000       /* ns, smaller differences are noise */
+#define EWMA_PERIODS   64
+
+#define JS_EVENT_BUTTON 0x01
+#define JS_EVENT_INIT   0x80
+
+typedef struct {
+  UINT64 count, min, max;
+  double sum;
+  UINT64 buckets[N_BUCKETS];
+} hist_t;
+
+enum {
+  CAP_AXIS_AGE,
+  CAP_BUTTON_AGE,
+  CAP_PERIOD,
+  CAP_JITTER,
+  TRACE_EVENT_EXCHANGE,
+  TRACE_SYNC_EXCHANGE,
+  TRACE_PERIOD,
+  TRACE_JITTER,
+  N_METRICS
+};
+
+static const char *metric_names[N_METRICS] = {
+  [CAP_AXIS_AGE]         = "capture axis age",
+  [CAP_BUTTON_AGE]       = "capture button age",
+  [CAP_PERIOD]           = "capture sync period",
+  [CAP_JITTER]           = "capture sync jitter",
+  [TRACE_EVENT_EXCHANGE] = "trace event->exchange",
+  [TRACE_SYNC_EXCHANGE]  = "trace sync->exchange",
+  [TRACE_PERIOD]         = "trace sync period",
+  [TRACE_JITTER]         = "trace sync jitter",
+};
+
+static const double percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+#define N_PERCENTILES (sizeof(percentiles) / sizeof(percentiles[0]))
+
+typedef struct {
+  hist_t metrics[N_METRICS];
+  UINT64 cycles, missed_syncs, hidden_changes;
+  UINT64 events, edges, dropped_edges, pending_overflows;
+} run_t;
+
+static UINT64 nominal_period;     /* ns, 0: moving average, see add_period() */
+
+/* Bucket of a value: exact below SUB, above that SUB / 2 buckets per power
+   of two */
+static unsigned int bucket(UINT64 v) {
+  unsigned int shift;
+
+  if (v < SUB)
+    return v;
+  shift = 63 - __builtin_clzll(v) - SUB_BITS + 1;
+  return SUB + (shift - 1) * (SUB / 2) + ((v >> shift) - SUB / 2);
+}
+
+/* Middle of the values of a bucket */
+static UINT64 bucket_value(unsigned int b) {
+  unsigned int shift;
+
+  if (b < SUB)
+    return b;
+  shift = (b - SUB) / (SUB / 2) + 1;
+  return ((UINT64)((b - SUB) % (SUB / 2) + SUB / 2) << shift) + ((UINT64)1 << (shift - 1));
+}
+
+static void hist_add_n(hist_t *h, UINT64 v, UINT64 n) {
+  if ((h->count == 0) || (v < h->min))
+    h->min = v;
+  if (v > h->max)
+    h->max = v;
+  h->count += n;
+  h->sum += (double)v * n;
+  h->buckets[bucket(v)] += n;
+}
+
+static void hist_add(hist_t *h, INT64 v) {
+  hist_add_n(h, (v > 0) ? (UINT64)v : 0, 1);
+}
+
+static UINT64 hist_percentile(const hist_t *h, double p) {
+  UINT64 rank, seen = 0, v;
+  unsigned int b;
+
+  if (h->count == 0)
+    return 0;
+  rank = (UINT64)(p / 100.0 * h->count + 0.5);
+  if (rank == 0)
+    rank = 1;
+  for (b = 0; b < N_BUCKETS; b++) {
+    seen += h->buckets[b];
+    if (seen >= rank)
+      break;
+  }
+  v = bucket_value(b);
+  return (v < h->min) ? h->min : (v > h->max) ? h->max : v;
+}
+
+/* Add a sync period and its deviation from the reference period: the
+   nominal one or the moving average over the last EWMA_PERIODS */
+static void add_period(run_t *run, int period_metric, int jitter_metric, UINT64 period,
+                       double *average) {
+  double reference;
+
+  if (*average == 0.0)
+    *average = period;
+  reference = (nominal_period != 0) ? nominal_period : *average;
+  if (2.0 * period > 3.0 * reference) {
+    run->missed_syncs += (UINT64)(period / reference + 0.5) - 1;
+    return;
+  }
+  hist_add(&run->metrics[period_metric], period);
+  hist_add(&run->metrics[jitter_metric], (INT64)(fabs(period - reference) + 0.5));
+  *average += (period - *average) / EWMA_PERIODS;
+}
+
+static UINT64 net_ns(UINT64 net_time) {
+  return (net_time >> 32) * 1000000000ULL + (net_time & 0xFFFFFFFF);
+}
+
+static UINT64 object_value(const capfile_t *cap, const capture_record_t *r, int k) {
+  UINT64 v = 0;
+
+  if (k >= 0)
+    memcpy(&v, r->pi + cap->header->objects[k].offset,
+           (cap->header->objects[k].size < sizeof(v)) ? cap->header->objects[k].size : sizeof(v));
+  return v;
+}
+
+static void analyze_capture(run_t *run, capfile_t *cap) {
+  const capture_record_t *r;
+  int axis_time = capfile_find(cap, 0x2001, 0x01);
+  int button_time = capfile_find(cap, 0x2001, 0x02);
+  int buttons[2] = { capfile_find(cap, 0x6000, 0x01), capfile_find(cap, 0x6000, 0x02) };
+  UINT64 soc, t_axis, t_button, b, prev_ns = 0, prev_axis = 0, prev_button = 0, prev_b = 0;
+  UINT16 prev_state = 0;
+  double average = 0.0;
+  int first = 1;
+
+  while ((r = capfile_next(cap)) != NULL) {
+    run->cycles++;
+    soc = (UINT64)r->net_sec * 1000000000ULL + r->net_nsec;
+    t_axis = object_value(cap, r, axis_time);
+    t_button = object_value(cap, r, button_time);
+    b = object_value(cap, r, buttons[0]) | (object_value(cap, r, buttons[1]) << 8);
+    /* the sync processing pauses outside of ReadyToOperate and Operational */
+    if (!first && (r->nmt_state == prev_state))
+      add_period(run, CAP_PERIOD, CAP_JITTER, r->time_ns - prev_ns, &average);
+    if (!first && (soc != 0)) {
+      if ((t_axis != prev_axis) && (t_axis != 0))
+        hist_add(&run->metrics[CAP_AXIS_AGE], soc - net_ns(t_axis));
+      if ((t_button != prev_button) && (t_button != 0)) {
+        hist_add(&run->metrics[CAP_BUTTON_AGE], soc - net_ns(t_button));
+        /* a button changed and changed back before the sync */
+        if (b == prev_b)
+          run->hidden_changes++;
+      }
+    }
+    prev_ns = r->time_ns;
+    prev_axis = t_axis;
+    prev_button = t_button;
+    prev_b = b;
+    prev_state = r->nmt_state;
+    first = 0;
+  }
+}
+
+typedef struct {
+  UINT64 pending[MAX_PENDING];
+  unsigned int n_pending;
+  UINT8 state[256], sent[256], edges[256];
+  UINT64 sync_ns, prev_sync_ns;
+  double average;
+} trace_state_t;
+
+static void trace_exchange(run_t *run, trace_state_t *s, UINT64 t) {
+  unsigned int i;
+
+  for (i = 0; i < s->n_pending; i++)
+    hist_add(&run->metrics[TRACE_EVENT_EXCHANGE], t - s->pending[i]);
+  s->n_pending = 0;
+  if (s->sync_ns != 0)
+    hist_add(&run->metrics[TRACE_SYNC_EXCHANGE], t - s->sync_ns);
+  s->sync_ns = 0;
+  /* of the edges of a button since the last exchange at most the last
+     one is seen by the MN, none if the button is back where it was */
+  for (i = 0; i < 256; i++) {
+    if (s->edges[i] == 0)
+      continue;
+    run->dropped_edges += s->edges[i] - (s->state[i] != s->sent[i]);
+    s->sent[i] = s->state[i];
+    s->edges[i] = 0;
+  }
+}
+
+static void trace_event(run_t *run, trace_state_t *s, UINT64 t, int type, int number, int value) {
+  UINT8 v = (value != 0);
+
+  if ((number < 0) || (number > 255))
+    return;
+  if (type & JS_EVENT_INIT) {
+    if (type & JS_EVENT_BUTTON)
+      s->state[number] = s->sent[number] = v;
+    return;
+  }
+  run->events++;
+  if (s->n_pending < MAX_PENDING)
+    s->pending[s->n_pending++] = t;
+  else
+    run->pending_overflows++;
+  if ((type & JS_EVENT_BUTTON) && (v != s->state[number])) {
+    run->edges++;
+    s->state[number] = v;
+    if (s->edges[number] < 255)
+      s->edges[number]++;
+  }
+}
+
+static int analyze_trace(run_t *run, FILE *fp, const char *path) {
+  static trace_state_t s;
+  char line[256], probe[64];
+  unsigned long long t;
+  int type, number, value, n;
+  unsigned long line_no = 0;
+
+  memset(&s, 0, sizeof(s));
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    line_no++;
+    if ((line[0] == '#') || (line[0] == '\n'))
+      continue;
+    if ((n = sscanf(line, "%llu %63s %d %d %d", &t, probe, &type, &number, &value)) < 2) {
+      /* bpftrace prints "Attaching N probes..." first */
+      if (line_no > 1)
+        fprintf(stderr, "%s:%lu: ignored\n", path, line_no);
+      continue;
+    }
+    if (strcmp(probe, "event_apply") == 0) {
+      if (n == 5)
+        trace_event(run, &s, t, type, number, value);
+    } else if (strcmp(probe, "sync_wakeup") == 0) {
+      if (s.prev_sync_ns != 0)
+        add_period(run, TRACE_PERIOD, TRACE_JITTER, t - s.prev_sync_ns, &s.average);
+      s.sync_ns = s.prev_sync_ns = t;
+      run->cycles++;
+    } else if (strcmp(probe, "exchange_start") == 0) {
+      trace_exchange(run, &s, t);
+    } else if (strcmp(probe, "nmt_state_change") == 0) {
+      /* no period across a pause of the sync processing */
+      s.prev_sync_ns = 0;
+    }
+  }
+  if (ferror(fp)) {
+    perror(path);
+    return -1;
+  }
+  return 0;
+}
+
+static int analyze(run_t *run, char *const *files, int n_files) {
+  capfile_t cap;
+  FILE *fp;
+  int i, ret;
+
+  for (i = 0; i < n_files; i++) {
+    if (strcmp(files[i], "-") == 0) {
+      fp = stdin;
+    } else {
+      /* not a capture, so it is a trace */
+      if ((ret = capfile_open(&cap, files[i])) < 0)
+        return -1;
+      if (ret == 0) {
+        analyze_capture(run, &cap);
+        capfile_close(&cap);
+        continue;
+      }
+      if ((fp = fopen(files[i], "r")) == NULL) {
+        perror(files[i]);
+        return -1;
+      }
+    }
+    ret = analyze_trace(run, fp, files[i]);
+    if (fp != stdin)
+      fclose(fp);
+    if (ret < 0)
+      return -1;
+  }
+  return 0;
+}
+
+static void print_row(const char *name, const char *label, const hist_t *h) {
+  unsigned int i;
+
+  printf("%-22s %-4s %10" PRIu64 " %10.1f", name, label, h->count, h->min / 1000.0);
+  for (i = 0; i < N_PERCENTILES; i++)
+    printf(" %10.1f", hist_percentile(h, percentiles[i]) / 1000.0);
+  printf(" %10.1f %10.1f\n", h->max / 1000.0, h->count ? h->sum / h->count / 1000.0 : 0.0);
+}
+
+/* Print the run, next to the baseline if there is one, and return the
+   number of percentiles that regressed by more than threshold percent */
+static int report(const run_t *run, const run_t *base, double threshold) {
+  const hist_t *h, *hb;
+  UINT64 p, pb;
+  unsigned int m, i;
+  int regressions = 0;
+  char label[16];
+
+  printf("%-22s %-4s %10s %10s", "[us]", "", "count", "min");
+  for (i = 0; i < N_PERCENTILES; i++) {
+    snprintf(label, sizeof(label), "p%g", percentiles[i]);
+    printf(" %10s", label);
+  }
+  printf(" %10s %10s\n", "max", "mean");
+  for (m = 0; m < N_METRICS; m++) {
+    h = &run->metrics[m];
+    hb = base ? &base->metrics[m] : NULL;
+    if ((h->count == 0) && ((hb == NULL) || (hb->count == 0)))
+      continue;
+    if (hb == NULL) {
+      print_row(metric_names[m], "", h);
+      continue;
+    }
+    print_row(metric_names[m], "base", hb);
+    print_row("", "run", h);
+    if ((h->count == 0) || (hb->count == 0))
+      continue;
+    printf("%-22s %-4s %10s %10s", "", "diff", "", "");
+    for (i = 0; i < N_PERCENTILES; i++) {
+      p = hist_percentile(h, percentiles[i]);
+      pb = hist_percentile(hb, percentiles[i]);
+      if ((p > pb * (1.0 + threshold / 100.0)) && (p - pb > MIN_REGRESSION)) {
+        printf(" %+8.0f%%!", pb ? 100.0 * ((double)p - pb) / pb : 100.0);
+        regressions++;
+      } else {
+        printf(" %+8.0f%% ", pb ? 100.0 * ((double)p - pb) / pb : 0.0);
+      }
+    }
+    printf("\n");
+  }
+
+  printf("\n");
+  if (base)
+    printf("%-22s %10s %10s\n", "", "base", "run");
+#define COUNTER(name, field)                                    \
+  do {                                                          \
+    printf("%-22s", name);                                      \
+    if (base)                                                   \
+      printf(" %10" PRIu64, base->field);                       \
+    printf(" %10" PRIu64 "\n", run->field);                     \
+  } while (0)
+  COUNTER("sync cycles", cycles);
+  COUNTER("missed syncs", missed_syncs);
+  COUNTER("hidden button changes", hidden_changes);
+  COUNTER("input events", events);
+  COUNTER("button edges", edges);
+  COUNTER("dropped button edges", dropped_edges);
+  if (run->pending_overflows || (base && base->pending_overflows))
+    COUNTER("unmatched events", pending_overflows);
+#undef COUNTER
+  return regressions;
+}
+
+int main(int argc, char *argv[]) {
+  static run_t run, base;
+  char *base_files[MAX_FILES];
+  int opt, n_base = 0, regressions;
+  double threshold = 10.0;
+
+  while ((opt = getopt(argc, argv, "b:t:T:")) != -1) {
+    switch (opt) {
+    case 'b':
+      if (n_base == MAX_FILES) {
+        fprintf(stderr, "At most %d baseline files\n", MAX_FILES);
+        return 2;
+      }
+      base_files[n_base++] = optarg;
+      break;
+    case 't':
+      threshold = strtod(optarg, NULL);
+      break;
+    case 'T':
+      nominal_period = strtoull(optarg, NULL, 10) * 1000;
+      break;
+    default:
+      goto usage;
+    }
+  }
+  if (optind == argc)
+    goto usage;
+
+  if ((n_base > 0) && (analyze(&base, base_files, n_base) < 0))
+    return 2;
+  if (analyze(&run, argv + optind, argc - optind) < 0)
+    return 2;
+  regressions = report(&run, (n_base > 0) ? &base : NULL, threshold);
+  if (regressions > 0) {
+    fprintf(stderr, "%d percentiles regressed by more than %g%%\n", regressions, threshold);
+    return 1;
+  }
+  return 0;
+
+usage:
+  fprintf(stderr, "Usage: %s [-b BASELINE_FILE]... [-t PERCENT] [-T PERIOD_US] FILE...\n", argv[0]);
+  fprintf(stderr, " FILE:             capture written with -p or trace of tools/trace-input.bt,\n");
+  fprintf(stderr, "                   \"-\" reads a trace from stdin\n");
+  fprintf(stderr, " -b BASELINE_FILE: compare with the run of the baseline files\n");
+  fprintf(stderr, " -t PERCENT:       regression threshold of the percentiles, default 10\n");
+  fprintf(stderr, " -T PERIOD_US:     nominal sync period, default the moving average\n");
+  return 2;
+}
@@ -0,0 +1,247 @@
+/* Object dictionary footprint report, built and run by "make od-report".
+
+   Links src/obdcreate.c with the objdict.h of the build, initializes the OD
+   tables like the stack does and walks the generic, manufacturer and device
+   parts.  For every object it prints:
+
+   - ROM:   default values, range limits and string descriptors (const)
+   - RAM:   current values, string buffers and variable entries of linked
+            objects (the linked data itself belongs to the application)
+   - table: the subindex table, kept in RAM
+   - pad:   bytes lost to alignment, in the subindex table entries and
+            between the values as the compiler laid them out
+
+   followed by the totals and the size of the index tables.  With -r/-m the
+   exit status is 1 if the ROM/RAM total exceeds the given budget. */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "obdcreate.h"
+
+#define MAX_REGIONS  4096
+#define MAX_ALIGN    16    /* larger gaps are not padding */
+
+typedef struct {
+  const UINT8  *addr;
+  size_t        size;
+  unsigned int  object;    /* position in objects[] */
+} region_t;
+
+typedef struct {
+  UINT          index;
+  unsigned int  subs;
+  size_t        rom, ram, table, pad;
+} object_t;
+
+static region_t rom_regions[MAX_REGIONS], ram_regions[MAX_REGIONS];
+static unsigned int n_rom, n_ram;
+static object_t objects[MAX_REGIONS];
+static unsigned int n_objects;
+
+static size_t type_size(tObdType type) {
+  switch (type) {
+  case kObdTypeBool:
+  case kObdTypeInt8:
+  case kObdTypeUInt8:
+    return 1;
+  case kObdTypeInt16:
+  case kObdTypeUInt16:
+    return 2;
+  case kObdTypeInt24:
+  case kObdTypeUInt24:
+    return 3;
+  case kObdTypeInt32:
+  case kObdTypeUInt32:
+  case kObdTypeReal32:
+    return 4;
+  case kObdTypeInt40:
+  case kObdTypeUInt40:
+    return 5;
+  case kObdTypeInt48:
+  case kObdTypeUInt48:
+  case kObdTypeTimeOfDay:
+  case kObdTypeTimeDiff:
+    return 6;
+  case kObdTypeInt56:
+  case kObdTypeUInt56:
+    return 7;
+  case kObdTypeInt64:
+  case kObdTypeUInt64:
+  case kObdTypeReal64:
+    return 8;
+  default:
+    return 0;
+  }
+}
+
+/* The storage of a fixed size value is rounded up to a power of two */
+static size_t storage_size(tObdType type) {
+  size_t size = type_size(type);
+
+  return (size > 4) ? 8 : (size == 3) ? 4 : size;
+}
+
+static void add_region(region_t *regions, unsigned int *n, const void *addr,
+                       size_t size, size_t *sum) {
+  if ((addr == NULL) || (size == 0))
+    return;
+  *sum += size;
+  if (*n == MAX_REGIONS) {
+    fprintf(stderr, "odreport: more than %u regions\n", MAX_REGIONS);
+    exit(2);
+  }
+  regions[*n].addr = addr;
+  regions[*n].size = size;
+  regions[*n].object = n_objects;
+  (*n)++;
+}
+
+static void walk_entry(const tObdEntry *entry) {
+  object_t *obj = &objects[n_objects];
+  const tObdSubEntry *sub;
+  unsigned int i, elems;
+  size_t size;
+
+  obj->index = entry->index;
+  obj->subs = entry->count;
+  for (i = 0, sub = entry->pSubIndex; i < entry->count; i++, sub++) {
+    obj->table += sizeof(*sub);
+    obj->pad += sizeof(*sub) - (sizeof(sub->subIndex) + sizeof(sub->type) +
+                                sizeof(sub->access) + sizeof(sub->pDefault) +
+                                sizeof(sub->pCurrent));
+    /* one table entry holds all elements of an array */
+    elems = (sub->access & kObdAccArray) ? entry->count - i : 1;
+
+    if (sub->type == kObdTypeVString) {
+      const tObdVStringDef *def = sub->pDefault;
+
+      add_region(rom_regions, &n_rom, def, sizeof(*def), &obj->rom);
+      add_region(ram_regions, &n_ram, def->pString, def->size + 1, &obj->ram);
+      add_region(ram_regions, &n_ram, sub->pCurrent, sizeof(tObdVString), &obj->ram);
+    } else if (sub->type == kObdTypeOString) {
+      const tObdOStringDef *def = sub->pDefault;
+
+      add_region(rom_regions, &n_rom, def, sizeof(*def), &obj->rom);
+      add_region(ram_regions, &n_ram, def->pString, def->size, &obj->ram);
+      add_region(ram_regions, &n_ram, sub->pCurrent, sizeof(tObdOString), &obj->ram);
+    } else {
+      size = storage_size(sub->type);
+      add_region(rom_regions, &n_rom, sub->pDefault,
+                 (sub->access & kObdAccRange) ? 3 * size : size, &obj->rom);
+      if (sub->access & kObdAccVar)
+        size = sizeof(tObdVarEntry);
+      add_region(ram_regions, &n_ram, sub->pCurrent, elems * size, &obj->ram);
+    }
+    if (elems > 1)
+      break;
+  }
+  n_objects++;
+}
+
+static size_t walk_part(const tObdEntry *part) {
+  const tObdEntry *entry;
+
+  if (part == NULL)
+    return 0;
+  for (entry = part; entry->index != OBD_TABLE_INDEX_END; entry++)
+    walk_entry(entry);
+  return (entry - part + 1) * sizeof(*entry);
+}
+
+static int region_cmp(const void *a, const void *b) {
+  const UINT8 *x = ((const region_t *)a)->addr, *y = ((const region_t *)b)->addr;
+
+  return (x > y) - (x < y);
+}
+
+/* Attribute the gap after each value to its object, if it is small enough
+   to be alignment and not the boundary of another section. */
+static size_t sum_padding(region_t *regions, unsigned int n) {
+  size_t gap, sum = 0;
+  unsigned int i;
+
+  qsort(regions, n, sizeof(*regions), region_cmp);
+  for (i = 0; i + 1 < n; i++) {
+    if (regions[i + 1].addr < regions[i].addr + regions[i].size)
+      continue;
+    gap = regions[i + 1].addr - (regions[i].addr + regions[i].size);
+    if (gap < MAX_ALIGN) {
+      objects[regions[i].object].pad += gap;
+      sum += gap;
+    }
+  }
+  return sum;
+}
+
+int main(int argc, char *argv[]) {
+  tObdInitParam param;
+  size_t rom = 0, ram = 0, table = 0, pad = 0, index_tab, rom_pad, ram_pad;
+  long rom_budget = -1, ram_budget = -1;
+  unsigned int i;
+  int opt, quiet = 0, ret = 0;
+
+  while ((opt = getopt(argc, argv, "r:m:q")) != -1) {
+    switch (opt) {
+    case 'r':
+      rom_budget = strtol(optarg, NULL, 10);
+      break;
+    case 'm':
+      ram_budget = strtol(optarg, NULL, 10);
+      break;
+    case 'q':
+      quiet = 1;
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-r ROM_BUDGET] [-m RAM_BUDGET] [-q]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  obdcreate_initObd(&param);
+  index_tab = walk_part((const tObdEntry *)param.pGenericPart) +
+              walk_part((const tObdEntry *)param.pManufacturerPart) +
+              walk_part((const tObdEntry *)param.pDevicePart);
+  rom_pad = sum_padding(rom_regions, n_rom);
+  ram_pad = sum_padding(ram_regions, n_ram);
+
+  if (!quiet)
+    printf("index   subs      ROM      RAM    table      pad\n");
+  for (i = 0; i < n_objects; i++) {
+    if (!quiet)
+      printf("0x%04X %5u %8zu %8zu %8zu %8zu\n", objects[i].index, objects[i].subs,
+             objects[i].rom, objects[i].ram, objects[i].table, objects[i].pad);
+    rom += objects[i].rom;
+    ram += objects[i].ram;
+    table += objects[i].table;
+    pad += objects[i].pad;
+  }
+
+  /* the subindex and index tables are writable, so they count as RAM */
+  printf("objects:        %8u\n", n_objects);
+  printf("ROM values:     %8zu (+%zu padding)\n", rom, rom_pad);
+  printf("RAM values:     %8zu (+%zu padding)\n", ram, ram_pad);
+  printf("subindex table: %8zu\n", table);
+  printf("index table:    %8zu\n", index_tab);
+  printf("padding:        %8zu\n", pad);
+  rom += rom_pad;
+  ram += ram_pad + table + index_tab;
+  printf("ROM total:      %8zu", rom);
+  if (rom_budget >= 0)
+    printf(" of %ld", rom_budget);
+  printf("\nRAM total:      %8zu", ram);
+  if (ram_budget >= 0)
+    printf(" of %ld", ram_budget);
+  printf("\n");
+
+  if ((rom_budget >= 0) && (rom > (size_t)rom_budget)) {
+    fprintf(stderr, "OD ROM footprint %zu exceeds the budget of %ld bytes\n", rom, rom_budget);
+    ret = 1;
+  }
+  if ((ram_budget >= 0) && (ram > (size_t)ram_budget)) {
+    fprintf(stderr, "OD RAM footprint %zu exceeds the budget of %ld bytes\n", ram, ram_budget);
+    ret = 1;
+  }
+  return ret;
+}
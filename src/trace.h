@@ -0,0 +1,28 @@
+#pragma once
+
+/* Static tracing probes (USDT).  With <sys/sdt.h> available each probe is a
+   single NOP plus an ELF note describing its location and arguments, which
+   perf, bpftrace or systemtap can attach to at runtime, e.g.
+
+     bpftrace -e 'usdt:./powerlink-cn-joystick:plkjoy:exchange_end { ... }'
+
+   Without <sys/sdt.h>, or with --disable-usdt, the probes compile to
+   nothing. */
+
+#if defined(HAVE_SYS_SDT_H)
+#include <sys/sdt.h>
+
+#define TRACE_PROBE0(name)                      DTRACE_PROBE(plkjoy, name)
+#define TRACE_PROBE1(name, a1)                  DTRACE_PROBE1(plkjoy, name, a1)
+#define TRACE_PROBE2(name, a1, a2)              DTRACE_PROBE2(plkjoy, name, a1, a2)
+#define TRACE_PROBE3(name, a1, a2, a3)          DTRACE_PROBE3(plkjoy, name, a1, a2, a3)
+#define TRACE_PROBE4(name, a1, a2, a3, a4)      DTRACE_PROBE4(plkjoy, name, a1, a2, a3, a4)
+#define TRACE_PROBE5(name, a1, a2, a3, a4, a5)  DTRACE_PROBE5(plkjoy, name, a1, a2, a3, a4, a5)
+#else
+#define TRACE_PROBE0(name)                      do { } while (0)
+#define TRACE_PROBE1(name, a1)                  do { } while (0)
+#define TRACE_PROBE2(name, a1, a2)              do { } while (0)
+#define TRACE_PROBE3(name, a1, a2, a3)          do { } while (0)
+#define TRACE_PROBE4(name, a1, a2, a3, a4)      do { } while (0)
+#define TRACE_PROBE5(name, a1, a2, a3, a4, a5)  do { } while (0)
+#endif
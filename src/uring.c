@@ -0,0 +1,164 @@
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include "uring.h"
+
+#define URING_ENTRIES  (2 * URING_MAX_SLOTS)
+
+static int ring_fd = -1;
+static int fixed_buffers;
+static unsigned int to_submit;
+
+static void *sq_ring, *cq_ring;
+static size_t sq_ring_size, cq_ring_size;
+static struct io_uring_sqe *sqes;
+static size_t sqes_size;
+
+static unsigned int *sq_tail, *sq_mask, *sq_array;
+static unsigned int *cq_head, *cq_tail, *cq_mask;
+static struct io_uring_cqe *cqes;
+
+static UINT8 buffer_pool[URING_MAX_SLOTS][URING_BUF_SIZE] __attribute__((aligned(64)));
+
+/* Set up the ring and register the buffer pool.  Returns -1 if io_uring is
+   not available, e.g. on old kernels or when it is disabled by seccomp. */
+int uring_init(void) {
+  struct io_uring_params params;
+  struct iovec pool = { buffer_pool, sizeof(buffer_pool) };
+
+  if (ring_fd >= 0)
+    return 0;
+
+  memset(&params, 0, sizeof(params));
+  if ((ring_fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params)) < 0)
+    return -1;
+
+  sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+  cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (cq_ring_size > sq_ring_size)
+      sq_ring_size = cq_ring_size;
+    cq_ring_size = sq_ring_size;
+  }
+
+  sq_ring = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		 ring_fd, IORING_OFF_SQ_RING);
+  if (sq_ring == MAP_FAILED)
+    goto fail;
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    cq_ring = sq_ring;
+  } else {
+    cq_ring = mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		   ring_fd, IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED)
+      goto fail_sq;
+  }
+  sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  sqes = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	      ring_fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED)
+    goto fail_cq;
+
+  sq_tail  = (unsigned int *)((char *)sq_ring + params.sq_off.tail);
+  sq_mask  = (unsigned int *)((char *)sq_ring + params.sq_off.ring_mask);
+  sq_array = (unsigned int *)((char *)sq_ring + params.sq_off.array);
+  cq_head  = (unsigned int *)((char *)cq_ring + params.cq_off.head);
+  cq_tail  = (unsigned int *)((char *)cq_ring + params.cq_off.tail);
+  cq_mask  = (unsigned int *)((char *)cq_ring + params.cq_off.ring_mask);
+  cqes     = (struct io_uring_cqe *)((char *)cq_ring + params.cq_off.cqes);
+
+  /* pinning the pool may fail on a low RLIMIT_MEMLOCK, plain reads work too */
+  fixed_buffers = syscall(__NR_io_uring_register, ring_fd,
+			  IORING_REGISTER_BUFFERS, &pool, 1) == 0;
+  to_submit = 0;
+  return 0;
+
+fail_cq:
+  if (cq_ring != sq_ring)
+    munmap(cq_ring, cq_ring_size);
+fail_sq:
+  munmap(sq_ring, sq_ring_size);
+fail:
+  close(ring_fd);
+  ring_fd = -1;
+  return -1;
+}
+
+void uring_exit(void) {
+  if (ring_fd < 0)
+    return;
+  munmap(sqes, sqes_size);
+  if (cq_ring != sq_ring)
+    munmap(cq_ring, cq_ring_size);
+  munmap(sq_ring, sq_ring_size);
+  /* closing the ring cancels the reads still in flight */
+  close(ring_fd);
+  ring_fd = -1;
+}
+
+int uring_get_fd(void) {
+  return ring_fd;
+}
+
+/* Queue a read of up to len bytes from fd into the buffer of the slot.  It
+   is handed to the kernel by the next uring_submit(). */
+int uring_post_read(unsigned int slot, int fd, unsigned int len) {
+  unsigned int tail = *sq_tail;
+  unsigned int index = tail & *sq_mask;
+  struct io_uring_sqe *sqe = &sqes[index];
+
+  if ((slot >= URING_MAX_SLOTS) || (len > URING_BUF_SIZE)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+  sqe->fd = fd;
+  sqe->off = (UINT64)-1;        /* current position, devices are not seekable */
+  sqe->addr = (UINT64)(uintptr_t)buffer_pool[slot];
+  sqe->len = len;
+  sqe->buf_index = 0;
+  sqe->user_data = slot;
+  sq_array[index] = index;
+  __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+  to_submit++;
+  return 0;
+}
+
+int uring_submit(void) {
+  int ret;
+
+  if (to_submit == 0)
+    return 0;
+  do {
+    ret = syscall(__NR_io_uring_enter, ring_fd, to_submit, 0, 0, NULL, 0);
+  } while ((ret < 0) && (errno == EINTR));
+  if (ret < 0)
+    return -1;
+  to_submit -= ret;
+  return ret;
+}
+
+/* Hand every completion queued on the ring to complete().  Does not enter
+   the kernel.  Returns the number of completions. */
+unsigned int uring_harvest(uring_complete_fn complete) {
+  unsigned int head = *cq_head;
+  unsigned int tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+  unsigned int count = 0;
+  struct io_uring_cqe *cqe;
+
+  while (head != tail) {
+    cqe = &cqes[head & *cq_mask];
+    complete(cqe->user_data, cqe->res, buffer_pool[cqe->user_data]);
+    head++;
+    count++;
+  }
+  __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+  return count;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <oplk/oplk.h>
+
+/* Minimal io_uring wrapper for reading the input devices.  Every input fd
+   owns a slot in a registered buffer pool and has one read posted on the
+   ring at a time.  The ring fd becomes readable when reads complete, so the
+   main loop waits on it instead of on the devices, and one io_uring_enter()
+   re-posts the reads of all devices after the completions were harvested.
+
+   Built without liburing, on top of the raw system calls. */
+
+#define URING_MAX_SLOTS  8
+#define URING_BUF_SIZE   512  /* 64 joydev events, or one hidraw report */
+
+typedef void (*uring_complete_fn)(unsigned int slot, int res, UINT8 *buf);
+
+int          uring_init(void);
+void         uring_exit(void);
+int          uring_get_fd(void);
+int          uring_post_read(unsigned int slot, int fd, unsigned int len);
+int          uring_submit(void);
+unsigned int uring_harvest(uring_complete_fn complete);
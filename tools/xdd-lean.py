@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Derive the XDD of the lean OD profile (CONFIG_APP_LEAN_OD in
+src/CiA401_CN/objdict.h) from the XDD of the full profile.
+
+  tools/xdd-lean.py [--max-node-id N] IN.xdd OUT.xdd
+
+The XDD is edited line by line, so that the output differs from its
+source only where the profiles differ.  The limits below must match
+objdict.h.
+"""
+
+import argparse
+import re
+import sys
+
+RPDO_MAPP_ENTRIES = 4     # 0x1600
+TPDO_MAPP_ENTRIES = 16    # 0x1A00
+
+# arrays indexed by node ID
+PER_NODE = (0x1050, 0x1F81, 0x1F8D, 0x1F9B)
+
+# objects not in the lean profile
+DROPPED = {0x1401, 0x1402, 0x1601, 0x1602, 0x6410, 0x6411, 0x6412}
+
+OBJECT = re.compile(r'\s*<Object index="([0-9A-Fa-f]{4})"')
+SUBOBJECT = re.compile(r'\s*<SubObject subIndex="([0-9A-Fa-f]{2})"')
+
+
+def limits(max_node_id):
+    """Highest subindex kept of the objects that are trimmed"""
+    trim = dict.fromkeys(PER_NODE, max_node_id)
+    trim[0x1600] = RPDO_MAPP_ENTRIES
+    trim[0x1A00] = TPDO_MAPP_ENTRIES
+    return trim
+
+
+def lean(lines, max_node_id):
+    trim = limits(max_node_id)
+    out = []
+    index = None
+    skip = False
+
+    for line in lines:
+        m = OBJECT.match(line)
+        if m:
+            index = int(m.group(1), 16)
+            # an object without subobjects is a single element
+            skip = index in DROPPED and not line.rstrip().endswith('/>')
+            if index in DROPPED:
+                continue
+        if skip:
+            skip = '</Object>' not in line
+            continue
+        if '</Object>' in line:
+            index = None
+
+        m = SUBOBJECT.match(line)
+        if m and index in trim:
+            sub = int(m.group(1), 16)
+            if sub > trim[index]:
+                continue
+            # per-node arrays announce their size in NumberOfEntries
+            if sub == 0 and index in PER_NODE:
+                line = re.sub(r'defaultValue="\d+"',
+                              'defaultValue="%d"' % max_node_id, line)
+
+        line = re.sub(r'PDORPDOChannels="\d+"', 'PDORPDOChannels="1"', line)
+        line = re.sub(r'PDORPDOChannelObjects="\d+"',
+                      'PDORPDOChannelObjects="%d"' % RPDO_MAPP_ENTRIES, line)
+        line = re.sub(r'PDOTPDOChannelObjects="\d+"',
+                      'PDOTPDOChannelObjects="%d"' % TPDO_MAPP_ENTRIES, line)
+        out.append(line)
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--max-node-id', type=int, default=32,
+                        help='CONFIG_APP_LEAN_OD_MAX_NODE_ID (default: 32)')
+    parser.add_argument('input')
+    parser.add_argument('output')
+    args = parser.parse_args()
+    if not 1 <= args.max_node_id <= 254:
+        sys.exit('max node ID must be 1 to 254')
+
+    with open(args.input, newline='') as f:
+        lines = f.readlines()
+    with open(args.output, 'w', newline='') as f:
+        f.writelines(lean(lines, args.max_node_id))
+
+
+if __name__ == '__main__':
+    main()